@@ -32,10 +32,17 @@
 // evolution). We did not mean to shout.
 #include "date.h"
 #include "hpdf.h"
+#include "planner_calendar.hpp"
+#include "planner_display_list.hpp"
+#include "planner_page_cache.hpp"
+#include "planner_pdf_writer.hpp"
 #include "utils.hpp"
 #include <cstdint>
+#include <functional>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <typeinfo>
 #include <vector>
 
@@ -44,12 +51,14 @@
 #define FILL_LIGHT 0.9
 #define FILL_DARK 0.5
 
+#define NOTES_LINE_GAP 40
+
 /*!
  * @brief
  * Base class for the different Planner elements
  *
  */
-class PlannerBase : public std::enable_shared_from_this<PlannerBase> {
+class PlannerBase {
 protected:
   std::uint64_t _id;
 
@@ -59,6 +68,12 @@ protected:
   /*! representing the PDF Page that this object is controlling */
   HPDF_Page _page;
 
+  /*! The writer the page is written with instead of libharu, if any */
+  PlannerPdfWriter* _pdf_writer;
+
+  /*! The id of the page in _pdf_writer */
+  std::uint32_t _page_id;
+
   /*! The font used for the notes header */
   HPDF_Font _notes_font;
 
@@ -99,14 +114,20 @@ protected:
   /*! The font size of the notes section title */
   HPDF_REAL _note_title_font_size;
 
+  /*!
+   * Navigation pointers to the parent and sibling page objects. These do not
+   * own the objects they point to, every page object is owned by the
+   * children list of its parent, so the tree is released top down.
+   */
+
   /*! A pointer to the parent page object */
-  std::shared_ptr<PlannerBase> _parent;
+  PlannerBase* _parent;
 
   /*! A pointer to the left page object */
-  std::shared_ptr<PlannerBase> _left;
+  PlannerBase* _left;
 
   /*! A pointer to the right page object */
-  std::shared_ptr<PlannerBase> _right;
+  PlannerBase* _right;
 
   /*! Whether it shouold be left handed orientation */
   bool _is_left_handed;
@@ -114,23 +135,47 @@ protected:
   /*! Whether it should be portrait / landscape orientation */
   bool _is_portrait;
 
+  /*! The drawing operations recorded for this page */
+  PlannerDisplayList _display_list;
+
+  /*! The cache the recorded operations are loaded from and stored to */
+  PlannerPageCache* _page_cache;
+
+  /*! Whether the page is written from the page cache, without recording */
+  bool _is_cached;
+  std::shared_ptr<const PlannerPageCache::Page> _cached_page;
+
+  /*! Whether the page is only created, without drawing anything on it */
+  bool _is_placeholder;
+
+  /*! What the page is drawn from and the pages it can link to, as used for
+   * the page cache */
+  std::string _cache_inputs;
+  std::vector<PlannerBase*> _cache_link_targets;
+
 public:
   PlannerBase()
-      : _id(0), _note_section_percentage(0.5), _page_title("Base"),
-        _page_title_font_size(45), _note_title_font_size(35),
-        _grid_string("GridBase"), _margin_width(Remarkable_margin_width_px),
-        _is_left_handed(false), _page_width(Remarkable_width_px),
-        _page_height(Remarkable_height_px), _is_portrait(false), _time_in_margin(false) {
+      : _id(0), _note_section_percentage(0.5), _pdf_writer(NULL),
+        _page_id(0), _page_height(Remarkable_height_px),
+        _page_width(Remarkable_width_px),
+        _margin_width(Remarkable_margin_width_px), _time_in_margin(false),
+        _page_title("Base"), _grid_string("GridBase"),
+        _page_title_font_size(45), _note_title_font_size(35), _parent(NULL),
+        _left(NULL), _right(NULL), _is_left_handed(false), _is_portrait(false),
+        _page_cache(NULL), _is_cached(false), _is_placeholder(false) {
     _margin_left = _margin_width;
     _margin_right = _page_width - _margin_width;
   }
 
   PlannerBase(std::string grid_string, bool is_left_handed)
-      : _id(0), _note_section_percentage(0.5), _page_title("Base"),
-        _page_title_font_size(45), _note_title_font_size(35),
-        _grid_string(grid_string), _margin_width((Remarkable_margin_width_px)),
-        _is_left_handed(is_left_handed), _page_width(Remarkable_width_px),
-        _page_height(Remarkable_height_px), _is_portrait(false) {
+      : _id(0), _note_section_percentage(0.5), _pdf_writer(NULL),
+        _page_id(0), _page_height(Remarkable_height_px),
+        _page_width(Remarkable_width_px),
+        _margin_width((Remarkable_margin_width_px)), _page_title("Base"),
+        _grid_string(grid_string), _page_title_font_size(45),
+        _note_title_font_size(35), _parent(NULL), _left(NULL), _right(NULL),
+        _is_left_handed(is_left_handed), _is_portrait(false),
+        _page_cache(NULL), _is_cached(false), _is_placeholder(false) {
     _margin_left = _margin_width;
     _margin_right = _page_width - _margin_width;
   }
@@ -138,13 +183,13 @@ public:
   void SetGridString(std::string grid_string) { _grid_string = grid_string; }
 
   void CreateThumbnail(HPDF_Doc& doc,
-                       HPDF_Page& page,
+                       PlannerDisplayList& display_list,
                        HPDF_REAL x_start,
                        HPDF_REAL y_start,
                        HPDF_REAL x_stop,
                        HPDF_REAL y_stop) {}
 
-  void FillAreaWithDots(HPDF_Page& page,
+  void FillAreaWithDots(PlannerDisplayList& display_list,
                         HPDF_REAL dot_spacing_x,
                         HPDF_REAL dot_spacing_y,
                         HPDF_REAL page_height,
@@ -155,19 +200,20 @@ public:
                         HPDF_REAL y_stop) {
 
     HPDF_REAL x = x_start;
-    const HPDF_UINT16 DASH_MODE1[] = {2, HPDF_UINT16(dot_spacing_x)};
 
     for (HPDF_REAL y = y_start; y < y_stop; y = y + dot_spacing_y) {
-      HPDF_Page_SetLineWidth(page, 2);
-      HPDF_Page_SetDash(page, DASH_MODE1, 2, 0);
-      HPDF_Page_MoveTo(page, x, page_height - y);
-      HPDF_Page_LineTo(page, x_stop, page_height - y);
-      HPDF_Page_Stroke(page);
+      display_list.AddLine(x,
+                           page_height - y,
+                           x_stop,
+                           page_height - y,
+                           2,
+                           FILL_DARK,
+                           2,
+                           HPDF_UINT16(dot_spacing_x));
     }
-    HPDF_Page_SetDash(page, NULL, 0, 0);
   }
 
-  void FillAreaWithLines(HPDF_Page& page,
+  void FillAreaWithLines(PlannerDisplayList& display_list,
                          bool is_vertical_line,
                          HPDF_REAL area_x_start,
                          HPDF_REAL area_y_start,
@@ -186,17 +232,22 @@ public:
       dim_stop = area_y_stop;
     }
 
-    HPDF_Page_SetLineWidth(page, 0.5);
-    HPDF_Page_SetGrayStroke(page, 0.5);
     for (HPDF_REAL dim = dim_start; dim < dim_stop; dim = dim + line_gap) {
       if (is_vertical_line) {
-        HPDF_Page_MoveTo(page, dim, page_height - area_y_start);
-        HPDF_Page_LineTo(page, dim, page_height - area_y_stop);
+        display_list.AddLine(dim,
+                             page_height - area_y_start,
+                             dim,
+                             page_height - area_y_stop,
+                             0.5,
+                             FILL_DARK);
       } else {
-        HPDF_Page_MoveTo(page, area_x_start, page_height - dim);
-        HPDF_Page_LineTo(page, area_x_stop, page_height - dim);
+        display_list.AddLine(area_x_start,
+                             page_height - dim,
+                             area_x_stop,
+                             page_height - dim,
+                             0.5,
+                             FILL_DARK);
       }
-      HPDF_Page_Stroke(page);
     }
   }
   /*!
@@ -204,35 +255,251 @@ public:
    * Create the page for this object with the given height and width
    */
   void CreatePage(HPDF_Doc doc, std::uint64_t height, std::uint64_t width) {
+    if (NULL != _pdf_writer) {
+      _page_id = _pdf_writer->AddPage(width, height);
+      return;
+    }
     _page = HPDF_AddPage(doc);
 
     _notes_font = HPDF_GetFont(doc, "Helvetica", NULL);
     HPDF_Page_SetHeight(_page, height);
-    _page_height = height;
     HPDF_Page_SetWidth(_page, width);
-    _page_width = width;
-    /* Draw the margin */
+  }
+
+  /*!
+   * Write everything recorded in the display list of this page to the PDF
+   * page and release the recorded operations
+   */
+  void FlushDisplayList(HPDF_Doc& doc, DisplayListStats* stats = NULL) {
+    auto get_target_page = [](PlannerBase* target) {
+      return target->GetPageId();
+    };
+    if (NULL != _cached_page) {
+      _pdf_writer->RewritePage(
+          _page_id,
+          _cached_page->written_page,
+          [this](size_t link_index) {
+            return _cache_link_targets[_cached_page->link_targets[link_index]]
+                ->GetPageId();
+          },
+          [this](const std::string& key) {
+            return _page_cache->FindSharedStream(key);
+          },
+          stats);
+    } else if (false == _cache_inputs.empty()) {
+      PlannerWrittenPage written_page;
+      _pdf_writer->WritePage(
+          _page_id, _display_list, get_target_page, stats, &written_page);
+      _page_cache->Store(_cache_inputs,
+                         std::move(written_page),
+                         _cache_link_targets,
+                         *_pdf_writer);
+    } else if (NULL != _pdf_writer) {
+      _pdf_writer->WritePage(_page_id, _display_list, get_target_page, stats);
+    } else {
+      _display_list.WriteToPage(
+          doc,
+          _page,
+          _notes_font,
+          [](PlannerBase* target) { return target->GetPage(); },
+          stats);
+    }
+    _cached_page.reset();
+    std::string().swap(_cache_inputs);
+    std::vector<PlannerBase*>().swap(_cache_link_targets);
+    _display_list.Clear();
+    if (NULL != stats) {
+      stats->pages++;
+    }
+  }
+
+  void SetPageCache(PlannerPageCache* page_cache) { _page_cache = page_cache; }
+
+  /*! Write the page with pdf_writer instead of libharu */
+  void SetPdfWriter(PlannerPdfWriter* pdf_writer) { _pdf_writer = pdf_writer; }
+
+  /*!
+   * Only create the page when it is built, leaving it empty. The page still
+   * exists for the pages linking to it, as when pages are added to an
+   * existing document which already has it.
+   */
+  void SetPlaceholder(bool is_placeholder) { _is_placeholder = is_placeholder; }
+
+  /*!
+   * Look this page, including its navigation, up in the page cache. The
+   * cache is addressed by everything the page is drawn from: its layout and
+   * options, its title and the titles of the pages it links to, plus
+   * page_inputs for whatever only a page type depends on. children are the
+   * pages below this one that it links to. Returns true if the page is
+   * cached, it is then written from the cache when it is flushed and must
+   * not be drawn. Otherwise the page is stored to the cache when it is
+   * flushed. The cache holds what the native writer wrote, pages written
+   * with libharu are not cached.
+   */
+  bool LoadFromPageCache(PlannerTypes page_type,
+                         const std::string& page_inputs,
+                         const std::vector<PlannerBase*>& children) {
+    if (NULL == _page_cache || false == _page_cache->IsEnabled() ||
+        NULL == _pdf_writer) {
+      return false;
+    }
+
+    _cache_link_targets = {_parent, _left, _right};
+    _cache_link_targets.insert(
+        _cache_link_targets.end(), children.begin(), children.end());
+
+    /* Appended piece by piece, every page is looked up on each run */
+    auto add_real = [this](HPDF_REAL value) {
+      PlannerPdfWriter::AppendReal(_cache_inputs, value);
+      _cache_inputs += '|';
+    };
+    _cache_inputs = std::to_string(page_type);
+    _cache_inputs += '|';
+    _cache_inputs += _page_title;
+    _cache_inputs += '|';
+    _cache_inputs += _grid_string;
+    _cache_inputs += '|';
+    add_real(_page_width);
+    add_real(_page_height);
+    add_real(_margin_width);
+    add_real(_note_section_percentage);
+    _cache_inputs += std::to_string(_is_left_handed) +
+                     std::to_string(_is_portrait) +
+                     std::to_string(_time_in_margin) + "|" +
+                     std::to_string(_time_gap_lines) + "|" +
+                     std::to_string(_time_start) + "|";
+    _cache_inputs += page_inputs;
+    for (PlannerBase* target : _cache_link_targets) {
+      _cache_inputs += '|';
+      _cache_inputs += (NULL != target) ? target->_page_title : "-";
+    }
+
+    _cached_page = _page_cache->Load(_cache_inputs, _cache_link_targets.size());
+    _is_cached = (NULL != _cached_page);
+    return _is_cached;
+  }
+
+  /*!
+   * Draw the margin line on the writing hand side of the page
+   */
+  void DrawMargin(PlannerDisplayList& display_list) {
     HPDF_REAL margin_x;
     if (_is_left_handed) {
       margin_x = _margin_right;
     } else {
       margin_x = _margin_left;
     }
-    HPDF_Page_SetLineWidth(_page, 1);
-    HPDF_Page_MoveTo(_page, margin_x, 0);
-    HPDF_Page_LineTo(_page, margin_x, _page_height);
-    HPDF_Page_Stroke(_page);
+    display_list.AddLine(margin_x, 0, margin_x, _page_height, 1);
+  }
+
+  /*!
+   * Draw the static background of the page: the margin line and, if the
+   * page has one, the divider and ruling of the notes section
+   */
+  void DrawPageTemplate(PlannerDisplayList& display_list, bool with_notes) {
+    DrawMargin(display_list);
+    if (true == with_notes) {
+      DrawNotesSectionLines(display_list);
+    }
+  }
+
+  /*!
+   * Stamp the static background of the page. The background only depends on
+   * the page type and layout, so it is recorded once per process, written
+   * once per document and every other page of the same kind references it.
+   * Anything in draw_extra is added to the same shared background.
+   */
+  void StampPageTemplate(
+      PlannerTypes page_type,
+      bool with_notes,
+      const std::function<void(PlannerDisplayList&)>& draw_extra = nullptr) {
+    static std::map<std::string, std::shared_ptr<const PlannerDisplayList>>
+        templates;
+    static std::mutex templates_mutex;
+
+    std::string template_key =
+        "template_" + std::to_string(page_type) + "_" +
+        (_is_portrait ? "portrait" : "landscape") + "_" +
+        (_is_left_handed ? "left" : "right") + "_" +
+        std::to_string(_page_width) + "_" + std::to_string(_page_height);
+
+    std::lock_guard<std::mutex> lock(templates_mutex);
+    auto template_it = templates.find(template_key);
+    if (template_it == templates.end()) {
+      auto page_template = std::make_shared<PlannerDisplayList>();
+      DrawPageTemplate(*page_template, with_notes);
+      if (draw_extra) {
+        draw_extra(*page_template);
+      }
+      template_it = templates.emplace(template_key, page_template).first;
+    }
+    _display_list.AddTemplate(template_key, template_it->second);
+  }
+
+  /*!
+   * Stamp a grid whose drawing only depends on its shape, such as the day grid
+   * of a month. The grid is recorded once per process by draw_grid, with its
+   * top left corner at the top left of the page, and is placed at x_start,
+   * y_start. Only the links differ between the copies of a grid, so the cell
+   * areas are kept with the grid and linked to objects, in the order
+   * draw_grid linked them, on every use.
+   */
+  void StampGridFragment(
+      PlannerDisplayList& display_list,
+      const std::string& fragment_key,
+      HPDF_REAL x_start,
+      HPDF_REAL y_start,
+      const std::vector<PlannerBase*>& objects,
+      const std::function<void(PlannerDisplayList&)>& draw_grid) {
+    struct GridFragment {
+      std::shared_ptr<PlannerDisplayList> content;
+      std::vector<HPDF_Rect> link_rects;
+    };
+    static std::map<std::string, GridFragment> fragments;
+    static std::mutex fragments_mutex;
+
+    std::lock_guard<std::mutex> lock(fragments_mutex);
+    auto fragment_it = fragments.find(fragment_key);
+    if (fragment_it == fragments.end()) {
+      PlannerDisplayList grid;
+      GridFragment fragment;
+      fragment.content = std::make_shared<PlannerDisplayList>();
+      draw_grid(grid);
+      for (const DrawOp& op : grid.GetOps()) {
+        if (DrawOpType_Link == op.type) {
+          fragment.link_rects.push_back(
+              {op.x_start, op.y_start, op.x_stop, op.y_stop});
+        } else {
+          fragment.content->CopyOp(op);
+        }
+      }
+      fragment_it = fragments.emplace(fragment_key, fragment).first;
+    }
+
+    display_list.AddTemplate(fragment_key,
+                             fragment_it->second.content,
+                             x_start,
+                             -y_start);
+    const std::vector<HPDF_Rect>& link_rects = fragment_it->second.link_rects;
+    for (size_t index = 0; index < link_rects.size() && index < objects.size();
+         index++) {
+      HPDF_Rect rect = {link_rects[index].left + x_start,
+                        link_rects[index].bottom - y_start,
+                        link_rects[index].right + x_start,
+                        link_rects[index].top - y_start};
+      display_list.AddLink(rect, objects[index]);
+    }
   }
 
   /*!
    * Set the navigation pointer for left sibling
    */
-  void SetLeft(std::shared_ptr<PlannerBase>& left) { _left = left; }
+  void SetLeft(PlannerBase* left) { _left = left; }
 
   /*!
    * Set the navigation pointer for the right sibling
    */
-  void SetRight(std::shared_ptr<PlannerBase>& right) { _right = right; }
+  void SetRight(PlannerBase* right) { _right = right; }
 
   /*!
    * Base function for the build operation to create the page
@@ -243,6 +510,8 @@ public:
 
   HPDF_Page& GetPage() { return _page; }
 
+  std::uint32_t GetPageId() { return _page_id; }
+
   void SetNotesSectionPercentage(double notes_section_percentage) {
     _note_section_percentage = notes_section_percentage;
   }
@@ -250,7 +519,7 @@ public:
   /*!
    * Function to paint the background of a link/anchor.
    */
-  void PaintRect(HPDF_Page& page,
+  void PaintRect(PlannerDisplayList& display_list,
                  HPDF_REAL page_height,
                  HPDF_REAL rect_x_start,
                  HPDF_REAL rect_y_start,
@@ -259,15 +528,11 @@ public:
                  HPDF_REAL padding_x,
                  HPDF_REAL padding_y,
                  HPDF_REAL gray) {
-    HPDF_REAL grayfill = HPDF_Page_GetGrayFill(page);
-    HPDF_Page_SetGrayFill(page, gray);
-    HPDF_STATUS status = HPDF_Page_Rectangle(page,
-                                             rect_x_start - padding_x,
-                                             page_height - (rect_y_stop + padding_y),
-                                             rect_x_stop - rect_x_start + (2 * padding_x),
-                                             rect_y_stop - rect_y_start + (2 * padding_y));
-    HPDF_Page_Fill(page);
-    HPDF_Page_SetGrayFill(page, grayfill);
+    display_list.AddRect(rect_x_start - padding_x,
+                         page_height - (rect_y_stop + padding_y),
+                         rect_x_stop - rect_x_start + (2 * padding_x),
+                         rect_y_stop - rect_y_start + (2 * padding_y),
+                         gray);
   }
 
   /*!
@@ -275,15 +540,14 @@ public:
    * clicked on will navigate to the parent page.
    */
   void CreateTitle() {
-    HPDF_Page_SetFontAndSize(_page, _notes_font, _page_title_font_size);
-    HPDF_Page_SetLineWidth(_page, 1);
-    HPDF_REAL page_title_text_x =
-        GetCenteredTextXPosition(_page, _page_title, 0, _page_width);
-    HPDF_REAL length = HPDF_Page_TextWidth(_page, _page_title.c_str());
+    HPDF_REAL page_title_text_x = GetCenteredTextXPosition(
+        _page_title_font_size, _page_title, 0, _page_width);
+    HPDF_REAL length =
+        GetTextWidth(_page_title_font_size, _page_title);
     HPDF_REAL x_padding = 20;
     HPDF_REAL y_padding = 0;
 
-    PaintRect(_page,
+    PaintRect(_display_list,
               _page_height,
               page_title_text_x,
               0,
@@ -293,51 +557,45 @@ public:
               y_padding,
               FILL_TITLE);
 
-    HPDF_Page_BeginText(_page);
-    HPDF_Page_MoveTextPos(
-        _page, page_title_text_x, _page_height - _page_title_font_size - 10);
     if (NULL != _parent) {
-      HPDF_Destination dest = HPDF_Page_CreateDestination(_parent->GetPage());
       HPDF_Rect rect = {page_title_text_x - x_padding,
                         _page_height - y_padding,
                         page_title_text_x + length + x_padding,
                         _page_height - ((_page_title_font_size * 2) + y_padding)};
-      HPDF_Annotation annotation = HPDF_Page_CreateLinkAnnot(_page, rect, dest);
+      _display_list.AddLink(rect, _parent);
     }
-    HPDF_Page_ShowText(_page, _page_title.c_str());
-    HPDF_Page_EndText(_page);
-
-    DrawTitleSeparator();
-
+    _display_list.AddText(page_title_text_x,
+                          _page_height - _page_title_font_size - 10,
+                          _page_title_font_size,
+                          _page_title);
   }
 
   void DrawTitleSeparator() {
-    HPDF_Page_SetLineWidth(_page, 2);
-    HPDF_Page_MoveTo(_page, 0, _page_height - (_page_title_font_size * 2));
-    HPDF_Page_LineTo(
-        _page, _page_width, _page_height - (_page_title_font_size * 2));
-    HPDF_Page_Stroke(_page);
+    _display_list.AddLine(0,
+                          _page_height - (_page_title_font_size * 2),
+                          _page_width,
+                          _page_height - (_page_title_font_size * 2),
+                          2);
   }
 
   /*!
    * Function to setup the left and right navigation elements of the page.
    */
   void AddNavigation() {
-    HPDF_Page_SetFontAndSize(_page, _notes_font, _page_title_font_size);
-    HPDF_Page_SetLineWidth(_page, 1);
     /* Add navigation to left and right */
     std::string left_string = "<";
     std::string right_string = ">";
-    HPDF_REAL page_title_text_x =
-        GetCenteredTextXPosition(_page, _page_title, 0, _page_width);
+    HPDF_REAL page_title_text_x = GetCenteredTextXPosition(
+        _page_title_font_size, _page_title, 0, _page_width);
     HPDF_REAL x_padding = 20;
     HPDF_REAL y_padding = 0;
 
     /* Add left navigation */
     if (NULL != _left) {
-      HPDF_REAL length = HPDF_Page_TextWidth(_page, left_string.c_str());
+      HPDF_REAL length =
+          GetTextWidth(_page_title_font_size, left_string);
 
-      PaintRect(_page,
+      PaintRect(_display_list,
                 _page_height,
                 page_title_text_x - 100,
                 0,
@@ -347,26 +605,25 @@ public:
                 y_padding,
                 FILL_TITLE);
 
-      HPDF_Page_BeginText(_page);
-      HPDF_Page_MoveTextPos(_page,
-                            page_title_text_x - 100,
-                            _page_height - _page_title_font_size - 10);
-      HPDF_Destination dest = HPDF_Page_CreateDestination(_left->GetPage());
       HPDF_Rect rect = {page_title_text_x - 100 - x_padding,
                         _page_height - y_padding,
                         page_title_text_x - 100 + length + x_padding,
                         _page_height - ((_page_title_font_size * 2) + y_padding)};
-      HPDF_Annotation annotation = HPDF_Page_CreateLinkAnnot(_page, rect, dest);
-      HPDF_Page_ShowText(_page, left_string.c_str());
-      HPDF_Page_EndText(_page);
+      _display_list.AddLink(rect, _left);
+      _display_list.AddText(page_title_text_x - 100,
+                            _page_height - _page_title_font_size - 10,
+                            _page_title_font_size,
+                            left_string);
     }
 
     /* Add right navigation */
     if (NULL != _right) {
-      HPDF_REAL title_length = HPDF_Page_TextWidth(_page, _page_title.c_str());
-      HPDF_REAL length = HPDF_Page_TextWidth(_page, right_string.c_str());
+      HPDF_REAL title_length =
+          GetTextWidth(_page_title_font_size, _page_title);
+      HPDF_REAL length =
+          GetTextWidth(_page_title_font_size, right_string);
 
-      PaintRect(_page,
+      PaintRect(_display_list,
                 _page_height,
                 page_title_text_x + title_length + 100 - length,
                 0,
@@ -375,85 +632,116 @@ public:
                 x_padding,
                 y_padding,
                 FILL_TITLE);
-      HPDF_Page_BeginText(_page);
-      HPDF_Page_MoveTextPos(_page,
-                            page_title_text_x + title_length + 100 - length,
-                            _page_height - _page_title_font_size - 10);
-      HPDF_Destination dest = HPDF_Page_CreateDestination(_right->GetPage());
       HPDF_Rect rect = {page_title_text_x + title_length + 100 - length - x_padding,
                         _page_height - y_padding,
                         page_title_text_x + title_length + 100 + x_padding,
                         _page_height - ((_page_title_font_size * 2) + y_padding)};
-      HPDF_Annotation annotation = HPDF_Page_CreateLinkAnnot(_page, rect, dest);
-      HPDF_Page_ShowText(_page, right_string.c_str());
-      HPDF_Page_EndText(_page);
+      _display_list.AddLink(rect, _right);
+      _display_list.AddText(page_title_text_x + title_length + 100 - length,
+                            _page_height - _page_title_font_size - 10,
+                            _page_title_font_size,
+                            right_string);
     }
     DrawTitleSeparator();
   }
 
   /*!
-   * Functin to generate the notes section
+   * Function to compute the area of the notes section and the position of
+   * the line dividing it from the rest of the page
    */
-  void CreateNotesSection(bool time_in_margin) {
-    HPDF_Page_SetFontAndSize(_page, _notes_font, _note_title_font_size);
-    HPDF_Page_SetLineWidth(_page, 2);
-
-    HPDF_REAL notes_divider_x_width;
-    HPDF_REAL notes_section_text_x;
-    HPDF_REAL notes_x_start;
-    HPDF_REAL notes_y_start;
-    HPDF_REAL notes_x_stop;
-    HPDF_REAL notes_y_stop;
-    HPDF_REAL margin_x;
-    HPDF_REAL divider_location_x;
-    std::string notes_string = "Notes";
-
-    notes_divider_x_width = _page_width * _note_section_percentage;
-
+  void GetNotesSectionArea(HPDF_REAL& notes_x_start,
+                           HPDF_REAL& notes_y_start,
+                           HPDF_REAL& notes_x_stop,
+                           HPDF_REAL& notes_y_stop,
+                           HPDF_REAL& divider_location_x) {
+    HPDF_REAL notes_divider_x_width = _page_width * _note_section_percentage;
+
+    notes_y_start = 2 * _page_title_font_size;
+    notes_y_stop = _page_height;
     if (_is_left_handed) {
       notes_x_start = _page_width - notes_divider_x_width;
-      notes_y_start = 2 * _page_title_font_size;
       notes_x_stop = _page_width;
-      notes_y_stop = _page_height;
-      margin_x = _margin_right;
       divider_location_x = notes_x_start;
-      notes_section_text_x = GetCenteredTextXPosition(
-          _page, notes_string, notes_x_start, _margin_right);
     } else {
       notes_x_start = 0;
-      notes_y_start = 2 * _page_title_font_size;
       notes_x_stop = notes_divider_x_width;
-      notes_y_stop = _page_height;
-      margin_x = _margin_left;
       divider_location_x = notes_x_stop;
-      notes_section_text_x = GetCenteredTextXPosition(
-          _page, notes_string, _margin_left, notes_divider_x_width);
     }
+  }
 
-    /* Draw dividing line between notes section and the rest of the page */
-    HPDF_Page_MoveTo(_page, divider_location_x, 0);
-    HPDF_Page_LineTo(_page, divider_location_x, _page_height - notes_y_start);
-    HPDF_Page_Stroke(_page);
+  /*!
+   * Function to draw the divider and the ruled lines of the notes section
+   */
+  void DrawNotesSectionLines(PlannerDisplayList& display_list) {
+    HPDF_REAL notes_x_start;
+    HPDF_REAL notes_y_start;
+    HPDF_REAL notes_x_stop;
+    HPDF_REAL notes_y_stop;
+    HPDF_REAL divider_location_x;
 
-    /* Print Notes section title */
-    HPDF_Page_BeginText(_page);
-    HPDF_Page_MoveTextPos(_page,
-                          notes_section_text_x,
-                          _page_height - notes_y_start - _note_title_font_size -
-                              10);
-    HPDF_Page_ShowText(_page, notes_string.c_str());
-    HPDF_Page_EndText(_page);
+    GetNotesSectionArea(notes_x_start,
+                        notes_y_start,
+                        notes_x_stop,
+                        notes_y_stop,
+                        divider_location_x);
 
-    HPDF_REAL dot_spacing = 40;
+    /* Draw dividing line between notes section and the rest of the page */
+    display_list.AddLine(divider_location_x,
+                         0,
+                         divider_location_x,
+                         _page_height - notes_y_start,
+                         2);
 
-    FillAreaWithLines(_page,
+    FillAreaWithLines(display_list,
                       false,
                       notes_x_start,
                       notes_y_start + (2 * _note_title_font_size),
                       notes_x_stop,
                       notes_y_stop - 30,
-                      dot_spacing,
+                      NOTES_LINE_GAP,
                       _page_height);
+  }
+
+  /*!
+   * Functin to generate the notes section title and the times in the margin.
+   * The lines of the section are part of the page template.
+   */
+  void CreateNotesSection(bool time_in_margin) {
+    HPDF_REAL notes_section_text_x;
+    HPDF_REAL notes_x_start;
+    HPDF_REAL notes_y_start;
+    HPDF_REAL notes_x_stop;
+    HPDF_REAL notes_y_stop;
+    HPDF_REAL margin_x;
+    HPDF_REAL divider_location_x;
+    std::string notes_string = "Notes";
+
+    GetNotesSectionArea(notes_x_start,
+                        notes_y_start,
+                        notes_x_stop,
+                        notes_y_stop,
+                        divider_location_x);
+
+    if (_is_left_handed) {
+      margin_x = _margin_right;
+      notes_section_text_x = GetCenteredTextXPosition(_note_title_font_size,
+                                                      notes_string,
+                                                      notes_x_start,
+                                                      _margin_right);
+    } else {
+      margin_x = _margin_left;
+      notes_section_text_x = GetCenteredTextXPosition(_note_title_font_size,
+                                                      notes_string,
+                                                      _margin_left,
+                                                      notes_x_stop);
+    }
+
+    /* Print Notes section title */
+    _display_list.AddText(notes_section_text_x,
+                          _page_height - notes_y_start -
+                              _note_title_font_size - 10,
+                          _note_title_font_size,
+                          notes_string);
 
     if(time_in_margin)
     {
@@ -465,7 +753,7 @@ public:
       }
       AddTimeToMargin(time_x ,
                       time_y ,
-                      dot_spacing,
+                      NOTES_LINE_GAP,
                       _page_height);
     }
   }
@@ -478,16 +766,17 @@ public:
   {
     char time_str[5];
     uint32_t i = 0;
-    HPDF_Page_SetFontAndSize(_page, _notes_font, 20);
+    HPDF_REAL time_font_size = 20;
     uint32_t time_gap_lines = 2;
     for(HPDF_REAL y = y_start + _note_title_font_size; y <= height; y = y + time_gap_lines * gap, i++ )
     {
       std::uint32_t time_int = (_time_start + i * 100) % 2400;
       sprintf(time_str, "%04d",time_int);
-      HPDF_Page_BeginText(_page);
-      HPDF_Page_MoveTextPos(_page, x_start - HPDF_Page_TextWidth(_page, time_str), height - y);
-      HPDF_Page_ShowText(_page, time_str);
-      HPDF_Page_EndText(_page);
+      _display_list.AddText(
+          x_start - GetTextWidth(time_font_size, time_str),
+          height - y,
+          time_font_size,
+          time_str);
       if(i == 1)
       {
         time_gap_lines = _time_gap_lines;
@@ -500,14 +789,14 @@ public:
    * Function to create a grid of child elements to be able to navigate to them
    */
   void CreateGrid(HPDF_Doc& doc,
-                  HPDF_Page& page,
+                  PlannerDisplayList& display_list,
                   HPDF_REAL x_start,
                   HPDF_REAL y_start,
                   HPDF_REAL x_stop,
                   HPDF_REAL y_stop,
                   HPDF_REAL num_rows,
                   HPDF_REAL num_cols,
-                  std::vector<std::shared_ptr<PlannerBase>>& objects,
+                  std::vector<PlannerBase*>& objects,
                   bool create_annotations,
                   size_t first_entry_offset,
                   bool create_thumbnail,
@@ -525,9 +814,8 @@ public:
     }
     HPDF_REAL x_step_size = (x_stop - x_start) / num_cols;
     HPDF_REAL y_step_size = (y_stop - y_start) / num_rows;
-    HPDF_Font font = HPDF_GetFont(doc, "Helvetica", NULL);
+    HPDF_REAL font_size = 25;
 
-    HPDF_Page_SetFontAndSize(page, font, 25);
     size_t object_index = 0;
 
     size_t row_num = 0;
@@ -548,7 +836,7 @@ public:
             if (true == create_thumbnail) {
               paint_rect_y_end = y_pad_start + 50;
             }
-            PaintRect(page,
+            PaintRect(display_list,
                       page_height,
                       x_pad_start,
                       y_pad_start,
@@ -559,24 +847,18 @@ public:
                       FILL_LIGHT);
           }
 
-          HPDF_Page_BeginText(page);
           HPDF_REAL grid_x_start =
-              GetCenteredTextXPosition(page,
+              GetCenteredTextXPosition(font_size,
                                        objects[object_index]->GetGridString(),
                                        x_pad_start,
                                        x_pad_end);
           HPDF_REAL grid_y_start = y_pad_start + 30;
           if (true == grid_string_in_middle) {
             grid_y_start = GetCenteredTextYPosition(
-                page, GetGridString(), grid_y_start, y_pad_end);
+                font_size, GetGridString(), grid_y_start, y_pad_end);
           }
 
-          HPDF_Page_MoveTextPos(
-              page, grid_x_start, _page_height - grid_y_start);
-
           if (true == create_annotations) {
-            HPDF_Destination dest =
-                HPDF_Page_CreateDestination(objects[object_index]->GetPage());
             HPDF_REAL rect_y_end = page_height - y_pad_end;
             if (true == create_thumbnail) {
               // To avoid the link covering the entire thumbnail, limit
@@ -586,17 +868,17 @@ public:
             }
             HPDF_Rect rect = {
                 x_pad_start, rect_y_end, x_pad_end, page_height - y_pad_start};
-            HPDF_Annotation annotation =
-                HPDF_Page_CreateLinkAnnot(page, rect, dest);
+            display_list.AddLink(rect, objects[object_index]);
           }
 
-          HPDF_Page_ShowText(page,
-                             objects[object_index]->GetGridString().c_str());
-          HPDF_Page_EndText(page);
+          display_list.AddText(grid_x_start,
+                               _page_height - grid_y_start,
+                               font_size,
+                               objects[object_index]->GetGridString());
 
           if (true == create_thumbnail) {
             CreateThumbnailCaller(doc,
-                                  page,
+                                  display_list,
                                   x_pad_start,
                                   y_pad_start,
                                   x_pad_end,
@@ -621,10 +903,11 @@ public:
       HPDF_REAL y_line_start = y_start + row_num * y_step_size;
       HPDF_REAL y_line_stop = y_start + row_num * y_step_size;
 
-      HPDF_Page_SetLineWidth(page, 2);
-      HPDF_Page_MoveTo(page, x_line_start, page_height - y_line_start);
-      HPDF_Page_LineTo(page, x_line_stop, page_height - y_line_stop);
-      HPDF_Page_Stroke(page);
+      display_list.AddLine(x_line_start,
+                           page_height - y_line_start,
+                           x_line_stop,
+                           page_height - y_line_stop,
+                           2);
     }
 
     for (size_t col_num = 1; col_num < num_cols; col_num++) {
@@ -634,10 +917,11 @@ public:
       HPDF_REAL y_line_start = y_start;
       HPDF_REAL y_line_stop = y_stop;
 
-      HPDF_Page_SetLineWidth(page, 1);
-      HPDF_Page_MoveTo(page, x_line_start, page_height - y_line_start);
-      HPDF_Page_LineTo(page, x_line_stop, page_height - y_line_stop);
-      HPDF_Page_Stroke(page);
+      display_list.AddLine(x_line_start,
+                           page_height - y_line_start,
+                           x_line_stop,
+                           page_height - y_line_stop,
+                           1);
     }
   }
 };
@@ -0,0 +1,137 @@
+#ifndef PLANNER_CALENDAR_HPP
+#define PLANNER_CALENDAR_HPP
+// The MIT License (MIT)
+//
+// Copyright (c) 2015, 2016, 2017 Howard Hinnant
+// Copyright (c) 2016 Adrian Colomitchi
+// Copyright (c) 2017 Florian Dang
+// Copyright (c) 2017 Paul Thompson
+// Copyright (c) 2018, 2019 Tomasz Kamiński
+// Copyright (c) 2019 Jiangang Zhuang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Our apologies.  When the previous paragraph was written, lowercase had not
+// yet been invented (that would involve another several millennia of
+// evolution). We did not mean to shout.
+#include "date.h"
+#include <cstdio>
+#include <string>
+
+/*!
+ * @brief
+ * The calendar strings used as page titles and grid entries. Names and day
+ * numbers come from static tables built once per process, titles are put
+ * together from those entries. Nothing goes through date::format, so no
+ * ostringstream or locale is involved and the strings can be built on any
+ * thread without locking. The names are those of the "C" locale that
+ * date::format used.
+ */
+class PlannerCalendarStrings {
+  static const std::string& WeekdayEntry(unsigned weekday) {
+    static const std::string weekdays[7] = {
+        "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+    return weekdays[weekday % 7];
+  }
+
+  static const std::string& MonthEntry(unsigned month) {
+    static const std::string months[12] = {"January",
+                                           "February",
+                                           "March",
+                                           "April",
+                                           "May",
+                                           "June",
+                                           "July",
+                                           "August",
+                                           "September",
+                                           "October",
+                                           "November",
+                                           "December"};
+    return months[(month - 1) % 12];
+  }
+
+  static const std::string& MonthAbbreviation(unsigned month) {
+    static const std::string months[12] = {"Jan",
+                                           "Feb",
+                                           "Mar",
+                                           "Apr",
+                                           "May",
+                                           "Jun",
+                                           "Jul",
+                                           "Aug",
+                                           "Sep",
+                                           "Oct",
+                                           "Nov",
+                                           "Dec"};
+    return months[(month - 1) % 12];
+  }
+
+  static const std::string& DayEntry(unsigned day) {
+    static const struct DayTable {
+      std::string days[32];
+      DayTable() {
+        for (unsigned day = 0; day < 32; day++) {
+          days[day] = {(char)('0' + day / 10), (char)('0' + day % 10)};
+        }
+      }
+    } table;
+    return table.days[day % 32];
+  }
+
+  static std::string YearEntry(const date::year& year) {
+    char year_str[8];
+    snprintf(year_str, sizeof(year_str), "%04d", (int)year);
+    return year_str;
+  }
+
+public:
+  /*! The title of a day page, e.g. "Mon January 04 2021" */
+  static std::string DayTitle(const date::year_month_day& day) {
+    return WeekdayEntry(date::weekday(day).c_encoding()) + " " +
+           MonthEntry((unsigned)day.month()) + " " +
+           DayEntry((unsigned)day.day()) + " " + YearEntry(day.year());
+  }
+
+  /*! The day of the month as shown in month grids, e.g. "04" */
+  static const std::string& DayNumber(const date::year_month_day& day) {
+    return DayEntry((unsigned)day.day());
+  }
+
+  /*! The title of a month page, e.g. " Jan 2021 " */
+  static std::string MonthTitle(const date::year_month& month) {
+    return " " + MonthAbbreviation((unsigned)month.month()) + " " +
+           YearEntry(month.year()) + " ";
+  }
+
+  /*! The abbreviated month name, e.g. "Jan" */
+  static const std::string& MonthName(const date::year_month& month) {
+    return MonthAbbreviation((unsigned)month.month());
+  }
+
+  /*! The title of a year page, e.g. "2021" */
+  static std::string YearTitle(const date::year& year) {
+    return YearEntry(year);
+  }
+
+  /*! The abbreviated weekday name, e.g. "Mon" */
+  static const std::string& WeekdayName(const date::weekday& weekday) {
+    return WeekdayEntry(weekday.c_encoding());
+  }
+};
+#endif // PLANNER_CALENDAR_HPP
@@ -52,7 +52,7 @@ public:
              date::month month,
              date::year year,
              PlannerBase* parent_week,
-             std::shared_ptr<PlannerBase> parent_month,
+             PlannerBase* parent_month,
              HPDF_REAL height,
              HPDF_REAL width,
              std::string page_title,
@@ -80,41 +80,61 @@ public:
     _time_start = time_start;
   }
 
-  void CreateTasksSection(HPDF_Doc& doc) {
-    std::string year_title_string = "Tasks";
+  /*!
+   * Function to compute the area of the tasks section
+   */
+  void GetTasksSectionArea(HPDF_REAL& section_x_start,
+                           HPDF_REAL& section_y_start,
+                           HPDF_REAL& section_x_stop,
+                           HPDF_REAL& section_y_stop) {
     HPDF_REAL notes_divider_x = _page_width * _note_section_percentage;
-    HPDF_REAL section_x_start;
-    HPDF_REAL section_y_start;
-    HPDF_REAL section_x_stop;
-    HPDF_REAL section_y_stop;
-    HPDF_REAL years_section_text_x;
 
+    section_y_start = _page_title_font_size * 2;
+    section_y_stop = _page_height;
     if (true == _is_left_handed) {
       section_x_start = 0;
-      section_y_start = _page_title_font_size * 2;
       section_x_stop = _page_width - notes_divider_x;
-      section_y_stop = _page_height;
-      years_section_text_x = GetCenteredTextXPosition(
-          _page, year_title_string, section_x_start, section_x_stop);
     } else {
       section_x_start = notes_divider_x;
-      section_y_start = _page_title_font_size * 2;
       section_x_stop = _page_width;
-      section_y_stop = _page_height;
-      years_section_text_x = GetCenteredTextXPosition(
-          _page, year_title_string, notes_divider_x, _page_width);
     }
-    HPDF_Page_BeginText(_page);
-    HPDF_Page_MoveTextPos(_page,
-                          years_section_text_x,
+  }
+
+  void CreateTasksSection(HPDF_Doc& doc) {
+    std::string year_title_string = "Tasks";
+    HPDF_REAL section_x_start;
+    HPDF_REAL section_y_start;
+    HPDF_REAL section_x_stop;
+    HPDF_REAL section_y_stop;
+
+    GetTasksSectionArea(
+        section_x_start, section_y_start, section_x_stop, section_y_stop);
+    HPDF_REAL years_section_text_x =
+        GetCenteredTextXPosition(_note_title_font_size,
+                                 year_title_string,
+                                 section_x_start,
+                                 section_x_stop);
+
+    _display_list.AddText(years_section_text_x,
                           _page_height -
-                              (section_y_start + _note_title_font_size + 10));
-    HPDF_Page_ShowText(_page, year_title_string.c_str());
-    HPDF_Page_EndText(_page);
+                              (section_y_start + _note_title_font_size + 10),
+                          _note_title_font_size,
+                          year_title_string);
+  }
 
-    /* @TODO : This increases filesize a lot, try to replace with pattern fill
-    or background png etc */
-    FillAreaWithDots(_page,
+  /*!
+   * Function to fill the tasks section with dots. This is part of the shared
+   * page template as it is the same on every day page.
+   */
+  void FillTasksSectionWithDots(PlannerDisplayList& display_list) {
+    HPDF_REAL section_x_start;
+    HPDF_REAL section_y_start;
+    HPDF_REAL section_x_stop;
+    HPDF_REAL section_y_stop;
+
+    GetTasksSectionArea(
+        section_x_start, section_y_start, section_x_stop, section_y_stop);
+    FillAreaWithDots(display_list,
                      40,
                      40,
                      _page_height,
@@ -125,10 +145,30 @@ public:
                      section_y_stop - 30);
   }
 
-  void CreateNavigation(HPDF_Doc& doc) { AddNavigation(); }
+  void CreateNavigation(HPDF_Doc& doc) {
+    if (false == _is_cached && false == _is_placeholder) {
+      AddNavigation();
+    }
+  }
 
   void Build(HPDF_Doc& doc) {
     CreatePage(doc, _page_height, _page_width);
+    Record(doc);
+  }
+
+  /*!
+   * Record the operations of the page without touching the PDF document,
+   * the page itself is created by CreatePage
+   */
+  void Record(HPDF_Doc& doc) {
+    if (true == _is_placeholder ||
+        true == LoadFromPageCache(PlannerTypes_Day, "", {})) {
+      return;
+    }
+    StampPageTemplate(
+        PlannerTypes_Day, true, [&](PlannerDisplayList& display_list) {
+          FillTasksSectionWithDots(display_list);
+        });
     CreateTitle();
     CreateNotesSection(_time_in_margin);
     CreateTasksSection(doc);
@@ -0,0 +1,371 @@
+#ifndef PLANNER_DISPLAY_LIST_HPP
+#define PLANNER_DISPLAY_LIST_HPP
+// The MIT License (MIT)
+//
+// Copyright (c) 2015, 2016, 2017 Howard Hinnant
+// Copyright (c) 2016 Adrian Colomitchi
+// Copyright (c) 2017 Florian Dang
+// Copyright (c) 2017 Paul Thompson
+// Copyright (c) 2018, 2019 Tomasz Kamiński
+// Copyright (c) 2019 Jiangang Zhuang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Our apologies.  When the previous paragraph was written, lowercase had not
+// yet been invented (that would involve another several millennia of
+// evolution). We did not mean to shout.
+#include "hpdf.h"
+#include "planner_shared_content.hpp"
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class PlannerBase;
+
+/*!
+ * @brief
+ * The kinds of drawing operations a page can record
+ */
+enum DrawOpType {
+  DrawOpType_Line,
+  DrawOpType_Rect,
+  DrawOpType_Text,
+  DrawOpType_Link,
+  DrawOpType_Template,
+};
+
+class PlannerDisplayList;
+
+/*!
+ * @brief
+ * Counters of what the display lists wrote to the document. Shared templates
+ * are only counted the one time they are written.
+ */
+struct DisplayListStats {
+  std::uint64_t pages = 0;
+  std::uint64_t links = 0;
+  std::uint64_t text_runs = 0;
+  /*! Path construction and painting operators: m, l, re, S and f */
+  std::uint64_t path_ops = 0;
+};
+
+/*!
+ * @brief
+ * A single recorded drawing operation. All coordinates are in PDF space,
+ * with the origin in the bottom left corner of the page.
+ */
+struct DrawOp {
+  DrawOpType type;
+
+  /*!
+   * Line end points, rectangle corners, text position, link area or the
+   * offset a template is placed at
+   */
+  HPDF_REAL x_start;
+  HPDF_REAL y_start;
+  HPDF_REAL x_stop;
+  HPDF_REAL y_stop;
+
+  /*! Line width of a line or font size of a text run */
+  HPDF_REAL size;
+
+  /*! Stroke gray of a line, fill gray of a rectangle or text run */
+  HPDF_REAL gray;
+
+  /*! Length of the dashes and gaps of a line, 0 for a solid line */
+  HPDF_UINT16 dash_on;
+  HPDF_UINT16 dash_off;
+
+  /*! The string of a text run or the key of a template */
+  std::string text;
+
+  /*! The page a link navigates to */
+  PlannerBase* target;
+
+  /*! The shared content of a template */
+  std::shared_ptr<const PlannerDisplayList> content;
+};
+
+/*!
+ * @brief
+ * An ordered list of drawing operations recorded by a page. Pages only
+ * record into their list, WriteToPage is the one place where the operations
+ * are turned into libharu calls.
+ */
+class PlannerDisplayList {
+  std::vector<DrawOp> _ops;
+
+public:
+  /*!
+   * The most decimals a coordinate is written with, libharu writes every
+   * number with up to 5 decimals
+   */
+  static constexpr int Max_decimals = 5;
+
+private:
+
+  DrawOp& AddOp(DrawOpType type) {
+    _ops.emplace_back();
+    DrawOp& op = _ops.back();
+    op.type = type;
+    op.x_start = op.y_start = op.x_stop = op.y_stop = 0;
+    op.size = 0;
+    op.gray = 0;
+    op.dash_on = op.dash_off = 0;
+    op.target = NULL;
+    return op;
+  }
+
+public:
+  /*! Record a stroked line */
+  void AddLine(HPDF_REAL x_start,
+               HPDF_REAL y_start,
+               HPDF_REAL x_stop,
+               HPDF_REAL y_stop,
+               HPDF_REAL line_width,
+               HPDF_REAL gray = 0,
+               HPDF_UINT16 dash_on = 0,
+               HPDF_UINT16 dash_off = 0) {
+    DrawOp& op = AddOp(DrawOpType_Line);
+    op.x_start = x_start;
+    op.y_start = y_start;
+    op.x_stop = x_stop;
+    op.y_stop = y_stop;
+    op.size = line_width;
+    op.gray = gray;
+    op.dash_on = dash_on;
+    op.dash_off = dash_off;
+  }
+
+  /*! Record a filled rectangle */
+  void AddRect(HPDF_REAL x,
+               HPDF_REAL y,
+               HPDF_REAL width,
+               HPDF_REAL height,
+               HPDF_REAL gray) {
+    DrawOp& op = AddOp(DrawOpType_Rect);
+    op.x_start = x;
+    op.y_start = y;
+    op.x_stop = x + width;
+    op.y_stop = y + height;
+    op.gray = gray;
+  }
+
+  /*! Record a run of black Helvetica text starting at the given position */
+  void AddText(HPDF_REAL x,
+               HPDF_REAL y,
+               HPDF_REAL font_size,
+               const std::string& text) {
+    DrawOp& op = AddOp(DrawOpType_Text);
+    op.x_start = x;
+    op.y_start = y;
+    op.size = font_size;
+    op.text = text;
+  }
+
+  /*! Record a link from the given area to the page of target */
+  void AddLink(const HPDF_Rect& rect, PlannerBase* target) {
+    DrawOp& op = AddOp(DrawOpType_Link);
+    op.x_start = rect.left;
+    op.y_start = rect.bottom;
+    op.x_stop = rect.right;
+    op.y_stop = rect.top;
+    op.target = target;
+  }
+
+  /*!
+   * Record a template, content that is written once per document under the
+   * given key and then shared by every page using the same key. The content
+   * is placed moved by x_offset and y_offset.
+   */
+  void AddTemplate(const std::string& key,
+                   std::shared_ptr<const PlannerDisplayList> content,
+                   HPDF_REAL x_offset = 0,
+                   HPDF_REAL y_offset = 0) {
+    DrawOp& op = AddOp(DrawOpType_Template);
+    op.x_start = x_offset;
+    op.y_start = y_offset;
+    op.text = key;
+    op.content = content;
+  }
+
+  /*!
+   * Round a coordinate to the given number of decimals. Page coordinates are
+   * device pixels on the reMarkable, so whole numbers, or one decimal, look
+   * the same on the device and are written with far fewer digits.
+   */
+  static HPDF_REAL Quantize(HPDF_REAL value, int decimals) {
+    if (decimals >= Max_decimals) {
+      return value;
+    }
+    static const double scales[Max_decimals] = {1, 10, 100, 1000, 10000};
+    double scale = scales[(decimals > 0) ? decimals : 0];
+    return (HPDF_REAL)(std::round(value * scale) / scale);
+  }
+
+  /*! Record a copy of an operation recorded in another list */
+  void CopyOp(const DrawOp& op) { _ops.push_back(op); }
+
+  const std::vector<DrawOp>& GetOps() const { return _ops; }
+
+  bool Empty() const { return _ops.empty(); }
+
+  void Clear() { std::vector<DrawOp>().swap(_ops); }
+
+  /*!
+   * Write the recorded operations to a libharu page. Consecutive lines
+   * sharing the same style are stroked as a single path and the graphics
+   * state is only changed when an operation needs a different one. The
+   * state of the page is not assumed, so the output is also valid as shared
+   * content placed anywhere on another page. Coordinates are rounded to
+   * the precision set for the document. If stats is given, what is written
+   * is added to it.
+   */
+  void WriteToPage(HPDF_Doc doc,
+                   HPDF_Page page,
+                   HPDF_Font font,
+                   const std::function<HPDF_Page(PlannerBase*)>& get_target_page,
+                   DisplayListStats* stats = NULL) const {
+    DisplayListStats local_stats;
+    if (NULL == stats) {
+      stats = &local_stats;
+    }
+    HPDF_REAL line_width = -1;
+    HPDF_REAL stroke_gray = -1;
+    HPDF_REAL fill_gray = -1;
+    HPDF_REAL font_size = -1;
+    int dash_on = -1;
+    int dash_off = -1;
+    bool path_open = false;
+    int decimals = PlannerSharedContent::GetPrecision(doc, Max_decimals);
+    auto quantize = [decimals](HPDF_REAL value) {
+      return Quantize(value, decimals);
+    };
+
+    auto close_path = [&]() {
+      if (path_open) {
+        HPDF_Page_Stroke(page);
+        stats->path_ops++;
+        path_open = false;
+      }
+    };
+
+    for (const DrawOp& op : _ops) {
+      if (op.type != DrawOpType_Line) {
+        close_path();
+      }
+
+      switch (op.type) {
+      case DrawOpType_Line:
+        if (op.size != line_width || op.gray != stroke_gray ||
+            op.dash_on != dash_on || op.dash_off != dash_off) {
+          close_path();
+        }
+        if (op.size != line_width) {
+          HPDF_Page_SetLineWidth(page, op.size);
+          line_width = op.size;
+        }
+        if (op.gray != stroke_gray) {
+          HPDF_Page_SetGrayStroke(page, op.gray);
+          stroke_gray = op.gray;
+        }
+        if (op.dash_on != dash_on || op.dash_off != dash_off) {
+          if (op.dash_on == 0) {
+            HPDF_Page_SetDash(page, NULL, 0, 0);
+          } else {
+            const HPDF_UINT16 dash_mode[] = {op.dash_on, op.dash_off};
+            HPDF_Page_SetDash(page, dash_mode, 2, 0);
+          }
+          dash_on = op.dash_on;
+          dash_off = op.dash_off;
+        }
+        HPDF_Page_MoveTo(page, quantize(op.x_start), quantize(op.y_start));
+        HPDF_Page_LineTo(page, quantize(op.x_stop), quantize(op.y_stop));
+        stats->path_ops += 2;
+        path_open = true;
+        break;
+
+      case DrawOpType_Rect:
+        if (op.gray != fill_gray) {
+          HPDF_Page_SetGrayFill(page, op.gray);
+          fill_gray = op.gray;
+        }
+        HPDF_Page_Rectangle(page,
+                            quantize(op.x_start),
+                            quantize(op.y_start),
+                            quantize(op.x_stop) - quantize(op.x_start),
+                            quantize(op.y_stop) - quantize(op.y_start));
+        HPDF_Page_Fill(page);
+        stats->path_ops += 2;
+        break;
+
+      case DrawOpType_Text:
+        if (op.gray != fill_gray) {
+          HPDF_Page_SetGrayFill(page, op.gray);
+          fill_gray = op.gray;
+        }
+        if (op.size != font_size) {
+          HPDF_Page_SetFontAndSize(page, font, op.size);
+          font_size = op.size;
+        }
+        HPDF_Page_BeginText(page);
+        HPDF_Page_MoveTextPos(page, quantize(op.x_start), quantize(op.y_start));
+        HPDF_Page_ShowText(page, op.text.c_str());
+        HPDF_Page_EndText(page);
+        stats->text_runs++;
+        break;
+
+      case DrawOpType_Link: {
+        HPDF_Destination dest = PlannerSharedContent::GetDestination(
+            doc, get_target_page(op.target));
+        HPDF_Rect rect = {quantize(op.x_start),
+                          quantize(op.y_start),
+                          quantize(op.x_stop),
+                          quantize(op.y_stop)};
+        HPDF_Page_CreateLinkAnnot(page, rect, dest);
+        stats->links++;
+        break;
+      }
+
+      case DrawOpType_Template: {
+        bool is_moved = (0 != op.x_start) || (0 != op.y_start);
+        if (is_moved) {
+          HPDF_Page_GSave(page);
+          HPDF_Page_Concat(
+              page, 1, 0, 0, 1, quantize(op.x_start), quantize(op.y_start));
+        }
+        PlannerSharedContent::Stamp(
+            doc, page, op.text, [&](HPDF_Page& template_page) {
+              op.content->WriteToPage(
+                  doc, template_page, font, get_target_page, stats);
+            });
+        if (is_moved) {
+          HPDF_Page_GRestore(page);
+        }
+        break;
+      }
+      }
+    }
+    close_path();
+  }
+};
+#endif // PLANNER_DISPLAY_LIST_HPP
@@ -0,0 +1,318 @@
+#ifndef PLANNER_INCREMENTAL_UPDATE_HPP
+#define PLANNER_INCREMENTAL_UPDATE_HPP
+// The MIT License (MIT)
+//
+// Copyright (c) 2015, 2016, 2017 Howard Hinnant
+// Copyright (c) 2016 Adrian Colomitchi
+// Copyright (c) 2017 Florian Dang
+// Copyright (c) 2017 Paul Thompson
+// Copyright (c) 2018, 2019 Tomasz Kamiński
+// Copyright (c) 2019 Jiangang Zhuang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Our apologies.  When the previous paragraph was written, lowercase had not
+// yet been invented (that would involve another several millennia of
+// evolution). We did not mean to shout.
+#include "planner_pdf_file.hpp"
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <unordered_map>
+
+/*!
+ * @brief
+ * Adds pages to an existing planner as an incremental update, appended
+ * after the end of the file and leaving everything before it untouched.
+ * The pages come from a second document, the tail, laid out like the
+ * complete planner: the pages it shares with the existing file come first
+ * and are at the same positions, followed by the added pages. Shared pages
+ * that link to the added pages are drawn again in the tail and replace the
+ * existing pages under the same object numbers, every other shared page is
+ * a placeholder that only stands for the existing page.
+ */
+class PlannerIncrementalUpdate {
+  /*! Read the numbers of an array value such as a MediaBox */
+  static std::vector<double> GetNumbers(const std::string& value) {
+    std::vector<double> numbers;
+    size_t position = 0;
+    while (true) {
+      PlannerPdfFile::Token token =
+          PlannerPdfFile::NextToken(value, position, value.size());
+      if (token.kind == PlannerPdfFile::Token_End) {
+        break;
+      }
+      if (token.kind == PlannerPdfFile::Token_Number) {
+        numbers.push_back(strtod(value.c_str() + token.start, NULL));
+      }
+      position = token.end;
+    }
+    return numbers;
+  }
+
+  static bool IsSameBox(const std::string& a, const std::string& b) {
+    std::vector<double> a_numbers = GetNumbers(a);
+    std::vector<double> b_numbers = GetNumbers(b);
+    if (a_numbers.size() != 4 || b_numbers.size() != 4) {
+      return false;
+    }
+    for (size_t index = 0; index < 4; index++) {
+      if (std::fabs(a_numbers[index] - b_numbers[index]) > 0.01) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /*! Rewrite every reference of text with the object numbers of numbers */
+  static std::string
+  Renumber(const std::string& text,
+           const std::unordered_map<std::uint32_t, std::uint32_t>& numbers) {
+    std::string renumbered;
+    size_t position = 0;
+    for (auto& reference : PlannerPdfFile::GetReferences(text)) {
+      renumbered.append(text, position, reference.start - position);
+      renumbered += std::to_string(numbers.at(reference.number)) + " 0 R";
+      position = reference.end;
+    }
+    renumbered.append(text, position, std::string::npos);
+    return renumbered;
+  }
+
+  static void AppendObject(std::string& update,
+                           std::uint32_t number,
+                           std::uint32_t generation,
+                           const std::string& value) {
+    update += std::to_string(number) + " " + std::to_string(generation) +
+              " obj\n" + value + "\nendobj\n";
+  }
+
+public:
+  /*!
+   * Build the incremental update of original adding the pages of tail from
+   * first_new_page on. replaced_pages are the indexes of the pages of tail
+   * replacing the pages of original at the same index. The update is to be
+   * written right after original. Returns false, leaving update untouched,
+   * if the files do not match.
+   */
+  static bool Append(const std::string& original,
+                     const std::string& tail,
+                     const std::vector<size_t>& replaced_pages,
+                     size_t first_new_page,
+                     std::string& update) {
+    PlannerPdfFile original_file;
+    PlannerPdfFile tail_file;
+    std::vector<std::uint32_t> original_pages;
+    std::vector<std::uint32_t> tail_pages;
+    if (false == original_file.Read(original) ||
+        false == original_file.GetPages(original_pages)) {
+      std::cout << "[ERR] : Unable to read the pages of the existing document"
+                << std::endl;
+      return false;
+    }
+    if (false == tail_file.Read(tail) ||
+        false == tail_file.GetPages(tail_pages)) {
+      std::cout << "[ERR] : Unable to read the pages to add" << std::endl;
+      return false;
+    }
+    const std::string& trailer = original_file.GetTrailer();
+    if (false == PlannerPdfFile::GetEntry(trailer, "/Encrypt").empty()) {
+      std::cout << "[ERR] : Encrypted documents cannot be extended"
+                << std::endl;
+      return false;
+    }
+    if (original_pages.size() != first_new_page ||
+        tail_pages.size() <= first_new_page) {
+      std::cout << "[ERR] : The existing document has "
+                << original_pages.size() << " pages instead of "
+                << first_new_page << ", it was not made with the same years "
+                << "and options" << std::endl;
+      return false;
+    }
+    if (false == IsSameBox(
+                     PlannerPdfFile::GetEntry(
+                         original_file.GetValue(original_pages.front()),
+                         "/MediaBox"),
+                     PlannerPdfFile::GetEntry(
+                         tail_file.GetValue(tail_pages.front()), "/MediaBox"))) {
+      std::cout << "[ERR] : The existing document has a different page size"
+                << std::endl;
+      return false;
+    }
+    std::uint32_t root;
+    std::uint32_t page_tree;
+    if (false == PlannerPdfFile::GetReference(
+                     PlannerPdfFile::GetEntry(trailer, "/Root"), root) ||
+        false == PlannerPdfFile::GetReference(
+                     PlannerPdfFile::GetEntry(original_file.GetValue(root),
+                                              "/Pages"),
+                     page_tree)) {
+      return false;
+    }
+
+    /* The object numbers of the tail objects in the updated document */
+    std::unordered_map<std::uint32_t, std::uint32_t> numbers;
+    std::uint32_t next_number = original_file.GetSize();
+    for (size_t index = 0; index < tail_pages.size(); index++) {
+      numbers[tail_pages[index]] = (index < first_new_page)
+                                       ? original_pages[index]
+                                       : next_number++;
+    }
+    std::uint32_t new_node = next_number++;
+
+    std::deque<std::uint32_t> pending;
+    for (size_t index : replaced_pages) {
+      if (index >= first_new_page) {
+        return false;
+      }
+      pending.push_back(tail_pages[index]);
+    }
+    for (size_t index = first_new_page; index < tail_pages.size(); index++) {
+      pending.push_back(tail_pages[index]);
+    }
+
+    /* Offsets of the written objects by object number */
+    std::map<std::uint32_t, std::pair<size_t, std::uint32_t>> offsets;
+    std::string out;
+    if (false == original.empty() && original.back() != '\n') {
+      out += "\n";
+    }
+    std::unordered_map<std::uint32_t, size_t> page_indexes;
+    for (size_t index = 0; index < tail_pages.size(); index++) {
+      page_indexes[tail_pages[index]] = index;
+    }
+
+    while (false == pending.empty()) {
+      std::uint32_t tail_number = pending.front();
+      pending.pop_front();
+      const PlannerPdfFile::PdfObject* object = tail_file.GetObject(tail_number);
+      if (NULL == object) {
+        return false;
+      }
+      std::string value = tail_file.GetValue(tail_number);
+      std::string parent;
+      std::uint32_t generation = 0;
+      auto page_index = page_indexes.find(tail_number);
+      if (page_index != page_indexes.end()) {
+        /* Pages keep their place in the page tree of the document */
+        if (page_index->second < first_new_page) {
+          std::uint32_t number = original_pages[page_index->second];
+          parent = PlannerPdfFile::GetEntry(original_file.GetValue(number),
+                                            "/Parent");
+          generation = original_file.GetObject(number)->generation;
+        } else {
+          parent = std::to_string(new_node) + " 0 R";
+        }
+        PlannerPdfFile::SetEntry(value, "/Parent", "");
+      }
+      for (auto& reference : PlannerPdfFile::GetReferences(value)) {
+        if (numbers.end() == numbers.find(reference.number)) {
+          numbers[reference.number] = next_number++;
+          pending.push_back(reference.number);
+        }
+      }
+      value = Renumber(value, numbers);
+      if (false == parent.empty()) {
+        PlannerPdfFile::SetEntry(value, "/Parent", parent);
+      }
+      if (true == object->is_stream) {
+        /* The stream data is copied as it is */
+        value.append(tail,
+                     object->dictionary_end,
+                     object->value_end - object->dictionary_end);
+      }
+      std::uint32_t number = numbers.at(tail_number);
+      offsets[number] = {original.size() + out.size(), generation};
+      AppendObject(out, number, generation, value);
+    }
+
+    /* The added pages go under a node of their own below the root */
+    std::string kids;
+    for (size_t index = first_new_page; index < tail_pages.size(); index++) {
+      kids += std::to_string(numbers.at(tail_pages[index])) + " 0 R ";
+    }
+    size_t num_new_pages = tail_pages.size() - first_new_page;
+    offsets[new_node] = {original.size() + out.size(), 0};
+    AppendObject(out,
+                 new_node,
+                 0,
+                 "<<\n/Type /Pages\n/Kids [ " + kids + "]\n/Count " +
+                     std::to_string(num_new_pages) + "\n/Parent " +
+                     std::to_string(page_tree) + " 0 R\n>>");
+
+    std::string root_node = original_file.GetValue(page_tree);
+    std::string root_kids = PlannerPdfFile::GetEntry(root_node, "/Kids");
+    size_t kids_end = root_kids.rfind(']');
+    if (kids_end == std::string::npos) {
+      return false;
+    }
+    root_kids.insert(kids_end, std::to_string(new_node) + " 0 R ");
+    PlannerPdfFile::SetEntry(root_node, "/Kids", root_kids);
+    PlannerPdfFile::SetEntry(
+        root_node,
+        "/Count",
+        std::to_string(
+            strtoull(PlannerPdfFile::GetEntry(root_node, "/Count").c_str(),
+                     NULL,
+                     10) +
+            num_new_pages));
+    std::uint32_t root_generation =
+        original_file.GetObject(page_tree)->generation;
+    offsets[page_tree] = {original.size() + out.size(), root_generation};
+    AppendObject(out, page_tree, root_generation, root_node);
+
+    /* One subsection per run of consecutive object numbers */
+    size_t xref_offset = original.size() + out.size();
+    out += "xref\n";
+    for (auto run = offsets.begin(); run != offsets.end();) {
+      auto run_end = std::next(run);
+      std::uint32_t count = 1;
+      while (run_end != offsets.end() &&
+             run_end->first == run->first + count) {
+        run_end++;
+        count++;
+      }
+      out += std::to_string(run->first) + " " + std::to_string(count) + "\n";
+      for (; run != run_end; run++) {
+        char entry[32];
+        snprintf(entry,
+                 sizeof(entry),
+                 "%010llu %05u n\r\n",
+                 (unsigned long long)run->second.first,
+                 (unsigned)run->second.second);
+        out += entry;
+      }
+    }
+    out += "trailer\n<<\n/Size " + std::to_string(next_number) + "\n/Root " +
+           PlannerPdfFile::GetEntry(trailer, "/Root") + "\n";
+    std::string info = PlannerPdfFile::GetEntry(trailer, "/Info");
+    if (false == info.empty()) {
+      out += "/Info " + info + "\n";
+    }
+    std::string id = PlannerPdfFile::GetEntry(trailer, "/ID");
+    if (false == id.empty()) {
+      out += "/ID " + id + "\n";
+    }
+    out += "/Prev " + std::to_string(original_file.GetStartXref()) +
+           "\n>>\nstartxref\n" + std::to_string(xref_offset) + "\n%%EOF\n";
+    update.swap(out);
+    return true;
+  }
+};
+#endif // PLANNER_INCREMENTAL_UPDATE_HPP
@@ -30,7 +30,42 @@
 // Our apologies.  When the previous paragraph was written, lowercase had not
 // yet been invented (that would involve another several millennia of
 // evolution). We did not mean to shout.
+#include "planner_incremental_update.hpp"
+#include "planner_object_streams.hpp"
 #include "planner_year.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+
+/*!
+ * @brief
+ * Time in milliseconds spent in each phase of generating a planner. The
+ * phases run by the threads recording the years add up the time of every
+ * thread, so with several jobs they can exceed the wall time.
+ */
+struct PlannerPhaseTimes {
+  /*! Setting up the years, months and days and linking them together */
+  double tree_ms = 0;
+  /*! Creating the pages and recording what is drawn on them, on all threads */
+  double render_ms = 0;
+  /*! Recording the navigation between the pages, on all threads */
+  double navigation_ms = 0;
+  /*! Writing the recorded pages and links to the document */
+  double flush_ms = 0;
+  /*! Serializing the document to its file or sink */
+  double save_ms = 0;
+};
 
 /*!
  * @brief
@@ -40,14 +75,61 @@ class PlannerMain : public PlannerBase {
   date::year_month_day _base_date;
   std::string _filename;
   std::uint64_t _num_years;
-  std::vector<std::shared_ptr<PlannerBase>> _years;
+  /*! The year pages, stored contiguously */
+  std::vector<PlannerYear> _year_pages;
+  std::vector<PlannerBase*> _years;
   short _first_day_of_week;
   HPDF_Doc _pdf;
+  /*! The HPDF_COMP_* flags used to compress the document streams */
+  HPDF_UINT _compression_mode;
+  /*! The number of threads used to add the contents of the years */
+  unsigned _num_jobs;
+  /*! Whether the saved document is packed into object streams */
+  bool _use_object_streams;
+  /*! Whether the document is written by PlannerPdfWriter, not libharu */
+  bool _use_native_writer;
+  /*! The number of decimals coordinates are written with */
+  int _precision;
+  std::unique_ptr<PlannerPdfWriter> _native_writer;
+  /*! Whether the native writer writes to _filename while building */
+  bool _is_streamed;
+  /*! The file the native writer streams to, NULL when not streamed */
+  FILE* _output_file;
+  /*!
+   * The number of pages under each intermediate node of the page tree, 0
+   * for a flat page tree and -1 to balance the tree for the number of pages
+   */
+  int _pages_per_node;
+  /*! Instrumentation of the last generated planner */
+  PlannerPhaseTimes _phase_times;
+  /*! Guards the phase times added up by the threads recording the years */
+  std::mutex _phase_times_mutex;
+  DisplayListStats _display_list_stats;
+  std::uintmax_t _file_size;
+  /*! The cache of the year, month and day pages, disabled by default */
+  PlannerPageCache _planner_page_cache;
+  /*!
+   * The existing planner, one year shorter, the last year is added to. Empty
+   * to write the whole planner.
+   */
+  std::string _extend_filename;
+
+  template <typename Function> static double ElapsedMs(Function function) {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+  }
 
 public:
   PlannerMain()
       : _base_date((date::year)2021, (date::month)1, (date::day)1),
-        _num_years(10), _filename("test.pdf") {
+        _filename("test.pdf"), _num_years(10),
+        _compression_mode(HPDF_COMP_NONE), _num_jobs(1),
+        _use_object_streams(false), _use_native_writer(false),
+        _precision(PlannerDisplayList::Max_decimals), _is_streamed(false),
+        _output_file(NULL), _pages_per_node(-1), _file_size(0) {
     _page_title = "Planner";
     _note_section_percentage = 0.5;
   }
@@ -63,10 +145,15 @@ public:
               bool is_portrait,
               bool time_in_margin,
               int time_gap_lines,
-              int time_start
+              int time_start,
+              HPDF_UINT compression_mode
               )
       : _base_date((date::year)year, (date::month)1, (date::day)1),
-        _filename(filename), _num_years(num_years)  {
+        _filename(filename), _num_years(num_years),
+        _compression_mode(compression_mode), _num_jobs(1),
+        _use_object_streams(false), _use_native_writer(false),
+        _precision(PlannerDisplayList::Max_decimals), _is_streamed(false),
+        _output_file(NULL), _pages_per_node(-1), _file_size(0) {
     _page_title = "  Planner  ";
     _page_height = height;
     _page_width = width;
@@ -91,11 +178,80 @@ public:
   }
 
   void CreateDocument() {
+    if (true == _use_native_writer) {
+      _native_writer = std::make_unique<PlannerPdfWriter>(
+          _compression_mode, GetPagesPerNode(), GetNumPages());
+      _native_writer->SetPrecision(_precision);
+      _planner_page_cache.SetWriterSettings(_native_writer->GetSettings());
+      SetPdfWriter(_native_writer.get());
+      _pdf = NULL;
+      if (true == _is_streamed) {
+        OpenOutputFile();
+      }
+      return;
+    }
+    if (true == _planner_page_cache.IsEnabled()) {
+      std::cout << "[ERR] : The page cache only keeps pages written with "
+                   "--writer=native, it is not used"
+                << std::endl;
+    }
+    SetPdfWriter(NULL);
     _pdf = HPDF_New(this->err_cb, NULL);
     if (NULL == _pdf) {
       std::cout << "[ERR] Failed to create PDF object" << std::endl;
       throw std::exception();
     }
+    /* Drop anything left behind by a failed document at the same address */
+    PlannerSharedContent::Release(_pdf);
+    PlannerSharedContent::SetPrecision(_pdf, _precision);
+    HPDF_SetCompressionMode(_pdf, _compression_mode);
+    if (0 != GetPagesPerNode()) {
+      HPDF_SetPagesConfiguration(_pdf, GetPagesPerNode());
+    }
+  }
+
+  /*!
+   * Set the number of pages under each intermediate node of the page tree.
+   * libharu puts every page directly under the root by default, so a viewer
+   * following a link into a large planner has to go through one array of
+   * thousands of pages. With -1 the pages are split into about the square
+   * root of their number of nodes, each holding as many pages, which keeps
+   * both levels of the tree short. 0 keeps the flat tree.
+   */
+  void SetPagesPerNode(int pages_per_node) { _pages_per_node = pages_per_node; }
+
+  HPDF_UINT GetPagesPerNode() {
+    if (_pages_per_node >= 0) {
+      return _pages_per_node;
+    }
+    return std::max(2.0, std::ceil(std::sqrt((double)GetNumPages())));
+  }
+
+  /*! The number of pages of the planner, at most, as leap years vary */
+  size_t GetNumPages() {
+    /* The index, then a year, its months and its days for every year */
+    return 1 + _num_years * (1 + 12 + 366);
+  }
+
+  /*!
+   * Round the coordinates written to the pages to the given number of
+   * decimals, 0 snaps them to whole device pixels. Must be set before the
+   * document is created.
+   */
+  void SetPrecision(int decimals) { _precision = decimals; }
+
+  /*!
+   * Write the native writer's output to _filename as the pages are flushed
+   * instead of when the document is finished, see OpenOutputFile
+   */
+  void SetStreamed(bool is_streamed) { _is_streamed = is_streamed; }
+
+  /*!
+   * Write the document with PlannerPdfWriter instead of libharu, must be
+   * set before the document is created
+   */
+  void SetNativeWriter(bool use_native_writer) {
+    _use_native_writer = use_native_writer;
   }
 
   void CreateYearsSection(HPDF_Doc& doc) {
@@ -112,27 +268,29 @@ public:
       section_y_start = _page_title_font_size * 2;
       section_x_stop = notes_divider_x;
       section_y_stop = _page_height;
-      years_section_text_x = GetCenteredTextXPosition(
-          _page, year_title_string, section_x_start, section_x_stop);
+      years_section_text_x = GetCenteredTextXPosition(_note_title_font_size,
+                                                      year_title_string,
+                                                      section_x_start,
+                                                      section_x_stop);
     } else {
       section_x_start = notes_divider_x;
       section_y_start = _page_title_font_size * 2;
       section_x_stop = _page_width;
       section_y_stop = _page_height;
-      years_section_text_x = GetCenteredTextXPosition(
-          _page, year_title_string, section_x_start, section_x_stop);
+      years_section_text_x = GetCenteredTextXPosition(_note_title_font_size,
+                                                      year_title_string,
+                                                      section_x_start,
+                                                      section_x_stop);
     }
 
-    HPDF_Page_BeginText(_page);
-    HPDF_Page_MoveTextPos(_page,
-                          years_section_text_x,
+    _display_list.AddText(years_section_text_x,
                           _page_height - (_page_title_font_size * 2) -
-                              _note_title_font_size - 10);
-    HPDF_Page_ShowText(_page, year_title_string.c_str());
-    HPDF_Page_EndText(_page);
+                              _note_title_font_size - 10,
+                          _note_title_font_size,
+                          year_title_string);
 
     CreateGrid(doc,
-               _page,
+               _display_list,
                section_x_start + 20,
                section_y_start + (_note_title_font_size * 2),
                section_x_stop - 20,
@@ -150,50 +308,545 @@ public:
                true);
   }
 
-  void BuildYears() {
-    for (auto year : _years) {
-      std::static_pointer_cast<PlannerYear>(year)->Build(_pdf);
+  /*!
+   * Set the number of threads used to add the months and days of the years.
+   * The PDF document itself is always written by a single thread in page
+   * order, so the output does not depend on the number of jobs.
+   */
+  void SetNumJobs(unsigned num_jobs) { _num_jobs = num_jobs; }
+
+  /*!
+   * Pack the objects of the saved document into compressed object streams
+   * with a cross-reference stream, which makes it a PDF 1.5 file
+   */
+  void SetObjectStreams(bool use_object_streams) {
+    _use_object_streams = use_object_streams;
+  }
+
+  /*!
+   * Set the directory of the page cache. Pages drawn from the same inputs as
+   * in an earlier run are loaded from the cache instead of being drawn again.
+   */
+  void SetPageCacheDirectory(const std::string& directory) {
+    _planner_page_cache.Open(directory);
+  }
+
+  /*!
+   * Add the last year to the planner in extend_filename instead of writing
+   * the whole planner. The existing file must have been made with the same
+   * options for one year less. Only the pages which change are drawn: the
+   * new year, the index page with its years grid and the pages linking to
+   * the new year, which are the previous year page, its December page and
+   * December 31. They are added to the existing file as an incremental
+   * update. The other pages are created empty so the links have targets.
+   */
+  void SetExtendFile(const std::string& extend_filename) {
+    _extend_filename = extend_filename;
+  }
+
+  /*!
+   * Get the index of the first page of the last year and the indexes of the
+   * pages before it which link to it, the pages are in the order they are
+   * built
+   */
+  void GetExtendPages(size_t& first_new_page, std::vector<size_t>& replaced) {
+    /* The index page, then each year page followed by its months and days */
+    first_new_page = 1;
+    size_t last_year_page = 0;
+    for (size_t year_index = 0; year_index + 1 < _num_years; year_index++) {
+      date::year year = _base_date.year() + (date::years)year_index;
+      last_year_page = first_new_page;
+      first_new_page += 1 + 12 + (year.is_leap() ? 366 : 365);
     }
+    /* December is followed by its 31 days */
+    replaced = {0, last_year_page, first_new_page - 32, first_new_page - 1};
   }
 
-  void CreateNavigation() {
-    for (auto year : _years) {
-      std::static_pointer_cast<PlannerYear>(year)->CreateNavigation(_pdf);
+  /*!
+   * Only draw the pages which change when the last year is added to an
+   * existing planner, the others are placeholders
+   */
+  void SetExtendPlaceholders() {
+    for (size_t year_index = 0; year_index + 1 < _year_pages.size();
+         year_index++) {
+      PlannerYear& year = _year_pages[year_index];
+      bool is_previous_year = (year_index + 2 == _year_pages.size());
+      year.SetPlaceholder(false == is_previous_year);
+      for (auto& month : year.GetMonthPages()) {
+        month.SetPlaceholder(true);
+      }
+      for (auto& day : year.GetDayPages()) {
+        day.SetPlaceholder(true);
+      }
+      if (true == is_previous_year) {
+        year.GetMonthPages().back().SetPlaceholder(false);
+        year.GetDayPages().back().SetPlaceholder(false);
+      }
     }
   }
 
-  void Build() {
-    CreatePage(_pdf, _page_height, _page_width);
-    /* Add _num_years of year objects and call their build functions */
+  /*!
+   * Add the pages of the document to the existing planner and save the
+   * result to _filename, appending to the existing file if it is _filename.
+   * The document is freed.
+   */
+  bool SaveExtended(std::ostream& report) {
+    bool use_object_streams = _use_object_streams;
+    std::string tail;
+    _use_object_streams = false;
+    SaveToMemory(tail);
+    _use_object_streams = use_object_streams;
+
+    std::ifstream existing(_extend_filename, std::ios::binary);
+    if (!existing) {
+      report << "[ERR] : Unable to open file : " << _extend_filename
+             << std::endl;
+      return false;
+    }
+    std::string original((std::istreambuf_iterator<char>(existing)),
+                         std::istreambuf_iterator<char>());
+    existing.close();
+
+    size_t first_new_page;
+    std::vector<size_t> replaced;
+    std::string update;
+    GetExtendPages(first_new_page, replaced);
+    if (false == PlannerIncrementalUpdate::Append(
+                     original, tail, replaced, first_new_page, update)) {
+      report << "[ERR] : Unable to add the year to : " << _extend_filename
+             << std::endl;
+      return false;
+    }
+
+    std::error_code path_error;
+    bool is_in_place =
+        std::filesystem::equivalent(_extend_filename, _filename, path_error);
+    FILE* file = (_filename == "-") ? stdout
+                                    : fopen(_filename.c_str(),
+                                            is_in_place ? "ab" : "wb");
+    if (NULL == file) {
+      report << "[ERR] : Unable to open file : " << _filename << std::endl;
+      return false;
+    }
+    bool is_written =
+        (true == is_in_place ||
+         original.size() == fwrite(original.data(), 1, original.size(), file)) &&
+        update.size() == fwrite(update.data(), 1, update.size(), file);
+    if (0 != ((file == stdout) ? fflush(file) : fclose(file)) ||
+        false == is_written) {
+      report << "[ERR] : Failed to write file : " << _filename << std::endl;
+      return false;
+    }
+    report << "[INFO] : Added " << update.size() << " bytes to the "
+           << original.size() << " bytes of " << _extend_filename
+           << std::endl;
+    _file_size = original.size() + update.size();
+    return true;
+  }
+
+  /*!
+   * Function to add the months and days of every year, spreading the years
+   * over _num_jobs threads, and then link consecutive years together
+   */
+  void AddYearContents() {
+    std::atomic<size_t> next_year(0);
+    auto add_years = [&]() {
+      for (size_t year_index = next_year++; year_index < _years.size();
+           year_index = next_year++) {
+        _year_pages[year_index].AddMonths();
+      }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned job = 1; job < _num_jobs && job < _years.size(); job++) {
+      workers.emplace_back(add_years);
+    }
+    add_years();
+    for (auto& worker : workers) {
+      worker.join();
+    }
+
+    for (auto& year : _year_pages) {
+      year.LinkToPreviousYear();
+    }
+  }
+
+  /*!
+   * Record the pages of a year and their navigation. This reads the pages of
+   * the year and of the years next to it, which its pages link to, and does
+   * not touch the PDF document, so years are recorded on several threads.
+   */
+  void RecordYear(size_t year_index) {
+    PlannerYear& year = _year_pages[year_index];
+    double render_ms = ElapsedMs([&]() {
+      year.Record(_pdf);
+      year.RecordMonths(_pdf);
+    });
+    double navigation_ms = ElapsedMs([&]() { year.CreateNavigation(_pdf); });
+    std::lock_guard<std::mutex> lock(_phase_times_mutex);
+    _phase_times.render_ms += render_ms;
+    _phase_times.navigation_ms += navigation_ms;
+  }
+
+  /*!
+   * Function to build the pages of every year and write them to the document
+   * as soon as possible. Links are only resolved when the recorded pages are
+   * flushed, which needs every page they point to to exist. The pages of a
+   * year only link within the year and to the years next to it, so a year is
+   * flushed once the pages of the following year have been created and its
+   * recorded operations are released straight away instead of being kept
+   * for the whole document. Once the year after it has been flushed as well,
+   * nothing points into a year any more and its months and days are
+   * released.
+   *
+   * The pages are created and flushed on this thread in year order, which
+   * keeps the document the same for any number of jobs. The years are
+   * recorded on _num_jobs - 1 more threads, at most _num_jobs years ahead
+   * of the last year flushed so only a few years are recorded at a time.
+   */
+  void BuildYears() {
+    std::mutex mutex;
+    std::condition_variable changed;
+    size_t next_year = 0;
+    size_t num_flushed = 0;
+    std::vector<bool> is_recorded(_year_pages.size(), false);
+    size_t max_ahead = std::max(1u, _num_jobs);
+
+    /* Record the next year if it may be recorded yet, with lock held */
+    auto record_next_year = [&](std::unique_lock<std::mutex>& lock) {
+      if (next_year >= _year_pages.size() ||
+          next_year >= num_flushed + max_ahead) {
+        return false;
+      }
+      size_t year_index = next_year++;
+      lock.unlock();
+      RecordYear(year_index);
+      lock.lock();
+      is_recorded[year_index] = true;
+      changed.notify_all();
+      return true;
+    };
+    auto record_years = [&]() {
+      std::unique_lock<std::mutex> lock(mutex);
+      while (next_year < _year_pages.size()) {
+        if (false == record_next_year(lock)) {
+          changed.wait(lock);
+        }
+      }
+    };
+    /* This thread records the year itself when no other thread took it */
+    auto flush_year = [&](size_t year_index) {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (false == is_recorded[year_index]) {
+          if (next_year > year_index || false == record_next_year(lock)) {
+            changed.wait(lock);
+          }
+        }
+      }
+      _phase_times.flush_ms += ElapsedMs([&]() {
+        _year_pages[year_index].FlushDisplayLists(_pdf, &_display_list_stats);
+      });
+      std::lock_guard<std::mutex> lock(mutex);
+      num_flushed++;
+      changed.notify_all();
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned job = 1; job < _num_jobs && job < _year_pages.size(); job++) {
+      workers.emplace_back(record_years);
+    }
+    for (size_t year_index = 0; year_index < _year_pages.size(); year_index++) {
+      double render_ms =
+          ElapsedMs([&]() { _year_pages[year_index].CreatePages(_pdf); });
+      {
+        std::lock_guard<std::mutex> lock(_phase_times_mutex);
+        _phase_times.render_ms += render_ms;
+      }
+      if (year_index >= 1) {
+        flush_year(year_index - 1);
+      }
+      if (year_index >= 2) {
+        _year_pages[year_index - 2].ReleaseMonths();
+      }
+    }
+    if (false == _year_pages.empty()) {
+      flush_year(_year_pages.size() - 1);
+    }
+    for (auto& worker : workers) {
+      worker.join();
+    }
+  }
+
+  /*!
+   * Function to add _num_years of year objects, linked to each other
+   */
+  void AddYears() {
+    _year_pages.reserve(_num_years);
     for (size_t loop_index = 0; loop_index < _num_years; loop_index++) {
       date::year next_year = _base_date.year() + (date::years)loop_index;
-      _years.push_back(
-          std::make_shared<PlannerYear>(PlannerYear(next_year,
-                                                    shared_from_this(),
-                                                    _page_height,
-                                                    _page_width,
-                                                    _margin_width,
-                                                    _first_day_of_week,
-                                                    _is_left_handed,
-                                                    _is_portrait,
-                                                    _time_in_margin,
-                                                    _time_gap_lines,
-                                                    _time_start)));
+      _year_pages.emplace_back(next_year,
+                               this,
+                               _page_height,
+                               _page_width,
+                               _margin_width,
+                               _first_day_of_week,
+                               _is_left_handed,
+                               _is_portrait,
+                               _time_in_margin,
+                               _time_gap_lines,
+                               _time_start);
+      _year_pages.back().SetPageCache(&_planner_page_cache);
+      _year_pages.back().SetPdfWriter(_pdf_writer);
+      _years.push_back(&_year_pages.back());
       if (loop_index != 0) {
         _years.back()->SetLeft(_years[loop_index - 1]);
         _years[loop_index - 1]->SetRight(_years.back());
       }
     }
-    CreateTitle();
+  }
+
+  /*!
+   * Open _filename and hand the native writer's output to it as the pages
+   * are flushed, so the document is never held in memory as a whole. The
+   * object streams need the whole document and the extended planner is
+   * only written if the original matches, they are saved at the end.
+   */
+  void OpenOutputFile() {
+    if (true == _use_object_streams || false == _extend_filename.empty() ||
+        _filename == "-") {
+      return;
+    }
+    _output_file = fopen(_filename.c_str(), "wb");
+    if (NULL == _output_file) {
+      return;
+    }
+    FILE* file = _output_file;
+    _native_writer->SetSink([file](const HPDF_BYTE* data, HPDF_UINT32 size) {
+      return size == fwrite(data, 1, size, file);
+    });
+  }
+
+  void Build() {
+    _phase_times.tree_ms += ElapsedMs([&]() {
+      AddYears();
+      AddYearContents();
+      if (false == _extend_filename.empty()) {
+        SetExtendPlaceholders();
+      }
+    });
+    _phase_times.render_ms += ElapsedMs([&]() {
+      CreatePage(_pdf, _page_height, _page_width);
+      /* The index page exists once, so its background is drawn directly */
+      DrawPageTemplate(_display_list, true);
+      CreateTitle();
+      DrawTitleSeparator();
+    });
     BuildYears();
-    CreateNavigation();
-    CreateNotesSection(false);
-    CreateYearsSection(_pdf);
+    _phase_times.render_ms += ElapsedMs([&]() {
+      CreateNotesSection(false);
+      CreateYearsSection(_pdf);
+    });
+    _phase_times.flush_ms += ElapsedMs(
+        [&]() { FlushDisplayList(_pdf, &_display_list_stats); });
+  }
+
+  /*!
+   * Save the document to _filename and free it. A filename of "-" writes
+   * the document to the standard output, the report then goes to the
+   * standard error. Returns false if the document could not be written.
+   */
+  bool FinishDocument() {
+    bool is_stdout = (_filename == "-");
+    std::ostream& report = is_stdout ? std::cerr : std::cout;
+    _planner_page_cache.Save();
+    if (false == _extend_filename.empty()) {
+      if (false == SaveExtended(report)) {
+        return false;
+      }
+    } else if (true == is_stdout) {
+      std::cout.flush();
+      if (false == SaveToFileDescriptor(STDOUT_FILENO)) {
+        std::cerr << "[ERR] : Failed to write the document to the standard "
+                     "output"
+                  << std::endl;
+        return false;
+      }
+    } else if (NULL != _output_file) {
+      _phase_times.save_ms = ElapsedMs([&]() { _pdf_writer->Finish(); });
+      _file_size = _pdf_writer->GetSize();
+      bool is_written = _pdf_writer->IsSunk();
+      is_written = (0 == fclose(_output_file)) && true == is_written;
+      _output_file = NULL;
+      FreeDocument();
+      if (false == is_written) {
+        std::cout << "[ERR] : Failed to write file : " << _filename
+                  << std::endl;
+        return false;
+      }
+    } else if (true == _use_object_streams || NULL != _pdf_writer) {
+      FILE* file = fopen(_filename.c_str(), "wb");
+      if (NULL == file) {
+        std::cout << "[ERR] : Unable to open file : " << _filename
+                  << std::endl;
+        FreeDocument();
+        return false;
+      }
+      bool is_written =
+          SaveToSink([file](const HPDF_BYTE* data, HPDF_UINT32 size) {
+            return size == fwrite(data, 1, size, file);
+          });
+      if (0 != fclose(file) || false == is_written) {
+        std::cout << "[ERR] : Failed to write file : " << _filename
+                  << std::endl;
+        return false;
+      }
+    } else {
+      bool is_written = false;
+      _phase_times.save_ms = ElapsedMs([&]() {
+        try {
+          is_written = (HPDF_OK == HPDF_SaveToFile(_pdf, _filename.c_str()));
+        } catch (std::exception&) {
+          /* Reported by err_cb */
+        }
+      });
+      std::error_code size_error;
+      _file_size = std::filesystem::file_size(_filename, size_error);
+      FreeDocument();
+      if (false == is_written) {
+        std::cout << "[ERR] : Failed to write file : " << _filename
+                  << std::endl;
+        return false;
+      }
+    }
+    report << "[INFO] : Saved " << _filename << " : " << _file_size
+           << " bytes in " << (std::uint64_t)_phase_times.save_ms
+           << " ms with compression : "
+           << GetCompressionModeName(_compression_mode) << std::endl;
+    return true;
   }
 
-  void FinishDocument() {
-    HPDF_SaveToFile(_pdf, _filename.c_str());
+  /*!
+   * Serialize the document and hand it to sink in chunks as it is read from
+   * libharu, then free the document. Returns false if the sink failed, the
+   * rest of the document is then dropped.
+   */
+  bool SaveToSink(const PlannerOutputSink& sink) {
+    const HPDF_UINT32 chunk_size = 64 * 1024;
+    std::vector<HPDF_BYTE> chunk(chunk_size);
+    bool is_written = true;
+    _planner_page_cache.Save();
+    _file_size = 0;
+    _phase_times.save_ms = ElapsedMs([&]() {
+      if (NULL != _pdf_writer && false == _use_object_streams) {
+        const std::string& pdf = _pdf_writer->Finish();
+        is_written = sink((const HPDF_BYTE*)pdf.data(), pdf.size());
+        _file_size = pdf.size();
+        return;
+      }
+      HPDF_UINT32 remaining = 0;
+      if (NULL == _pdf_writer) {
+        HPDF_SaveToStream(_pdf);
+        remaining = HPDF_GetStreamSize(_pdf);
+      }
+      if (true == _use_object_streams) {
+        /* The whole document is needed to pack its objects */
+        std::string pdf;
+        std::string packed;
+        if (NULL != _pdf_writer) {
+          pdf = _pdf_writer->Finish();
+        } else {
+          pdf.resize(remaining);
+          HPDF_ReadFromStream(_pdf, (HPDF_BYTE*)&pdf[0], &remaining);
+          pdf.resize(remaining);
+        }
+        if (false == PlannerObjectStreams::Pack(pdf, packed)) {
+          std::cout << "[ERR] : Saving the document without object streams"
+                    << std::endl;
+          packed.swap(pdf);
+        }
+        is_written = sink((const HPDF_BYTE*)packed.data(), packed.size());
+        _file_size = packed.size();
+        return;
+      }
+      while (remaining > 0 && true == is_written) {
+        HPDF_UINT32 size = std::min(remaining, chunk_size);
+        HPDF_ReadFromStream(_pdf, chunk.data(), &size);
+        if (0 == size) {
+          break;
+        }
+        is_written = sink(chunk.data(), size);
+        remaining -= size;
+        _file_size += size;
+      }
+    });
+    FreeDocument();
+    return is_written;
+  }
+
+  /*! Write the document to an open file descriptor and free it */
+  bool SaveToFileDescriptor(int fd) {
+    return SaveToSink([fd](const HPDF_BYTE* data, HPDF_UINT32 size) {
+      while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0 && errno == EINTR) {
+          continue;
+        }
+        if (written <= 0) {
+          return false;
+        }
+        data += written;
+        size -= written;
+      }
+      return true;
+    });
+  }
+
+  /*! Write the document into pdf and free it */
+  void SaveToMemory(std::string& pdf) {
+    pdf.clear();
+    SaveToSink([&pdf](const HPDF_BYTE* data, HPDF_UINT32 size) {
+      pdf.append((const char*)data, size);
+      return true;
+    });
+  }
+
+  /*!
+   * Write the phase timings and the counters of what was written to the
+   * document as a single line JSON object
+   */
+  void PrintStats(std::ostream& out) {
+    out << "{\"file\": \"" << JsonEscape(_filename) << "\", \"years\": " << _num_years
+        << ", \"jobs\": " << _num_jobs << ", \"phases_ms\": {\"tree\": "
+        << _phase_times.tree_ms << ", \"render\": " << _phase_times.render_ms
+        << ", \"navigation\": " << _phase_times.navigation_ms
+        << ", \"flush\": " << _phase_times.flush_ms
+        << ", \"save\": " << _phase_times.save_ms
+        << "}, \"pages\": " << _display_list_stats.pages
+        << ", \"links\": " << _display_list_stats.links
+        << ", \"text_runs\": " << _display_list_stats.text_runs
+        << ", \"path_ops\": " << _display_list_stats.path_ops
+        << ", \"cache_hits\": " << _planner_page_cache.GetHits()
+        << ", \"cache_misses\": " << _planner_page_cache.GetMisses()
+        << ", \"bytes\": " << _file_size << "}" << std::endl;
+  }
+
+  HPDF_Doc GetDocument() { return _pdf; }
+
+  void FreeDocument() {
+    if (NULL != _pdf_writer) {
+      _native_writer.reset();
+      SetPdfWriter(NULL);
+      if (NULL != _output_file && 0 != fclose(_output_file)) {
+        std::cout << "[ERR] : Failed to write file : " << _filename
+                  << std::endl;
+      }
+      _output_file = NULL;
+      return;
+    }
+    PlannerSharedContent::Release(_pdf);
     HPDF_Free(_pdf);
+    _pdf = NULL;
   }
 };
 #endif // PLANNER_MAIN_HPP
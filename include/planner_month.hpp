@@ -41,7 +41,8 @@ class PlannerMonth : public PlannerBase {
   short _first_day_of_week;
 
   std::vector<std::shared_ptr<PlannerBase>> _weeks;
-  std::vector<std::shared_ptr<PlannerBase>> _days;
+  /*! The days of this month, owned by the day array of the year */
+  std::vector<PlannerBase*> _days;
 
 public:
   PlannerMonth()
@@ -54,7 +55,7 @@ public:
   }
 
   PlannerMonth(date::year_month month,
-               std::shared_ptr<PlannerBase> parent_year,
+               PlannerBase* parent_year,
                HPDF_REAL height,
                HPDF_REAL width,
                HPDF_REAL margin,
@@ -65,8 +66,8 @@ public:
                int time_gap_lines,
                int time_start)
       : _month(month) {
-    _page_title = format(" %b %Y ", _month);
-    _grid_string = format("%b", _month);
+    _page_title = PlannerCalendarStrings::MonthTitle(_month);
+    _grid_string = PlannerCalendarStrings::MonthName(_month);
     _page_height = height;
     _page_width = width;
     //    _note_section_percentage = 0.25;
@@ -83,47 +84,51 @@ public:
     _time_start = time_start;
   }
 
-  std::vector<std::shared_ptr<PlannerBase>>& GetDays() { return _days; }
+  std::vector<PlannerBase*>& GetDays() { return _days; }
 
-  /*! Function to build the days */
-  void AddDays() {
+  /*!
+   * Function to build the days. The days are constructed in place at the end
+   * of day_pages, which must have the capacity for them reserved so that
+   * the pointers to earlier days stay valid.
+   */
+  void AddDays(std::vector<PlannerDay>& day_pages) {
     date::year_month_day temp1 = date::year(_month.year()) / _month.month() / 1;
     date::year_month_day temp2 = temp1 + (date::months)1;
     size_t num_days = ((date::sys_days)temp2 - (date::sys_days)temp1).count();
 
     for (size_t i = 1; i <= num_days; i++) {
-      std::string day_page_title = format(
-          "%a %B %d %Y",
-          (date::year_month_day)((date::sys_days)temp1 + (date::days)(i - 1)));
-      std::string day_grid_title = format(
-          "%d",
-          (date::year_month_day)((date::sys_days)temp1 + (date::days)(i - 1)));
+      date::year_month_day day =
+          (date::year_month_day)((date::sys_days)temp1 + (date::days)(i - 1));
+      std::string day_page_title = PlannerCalendarStrings::DayTitle(day);
+      const std::string& day_grid_title =
+          PlannerCalendarStrings::DayNumber(day);
 
-      _days.push_back(
-          std::make_shared<PlannerDay>(PlannerDay(temp1.day(),
-                                                  temp1.month(),
-                                                  temp1.year(),
-                                                  NULL,
-                                                  shared_from_this(),
-                                                  _page_height,
-                                                  _page_width,
-                                                  day_page_title,
-                                                  day_grid_title,
-                                                  _margin_width,
-                                                  _is_left_handed,
-                                                  _is_portrait,
-                                                  _time_in_margin,
-                                                  _time_gap_lines,
-                                                  _time_start)));
+      day_pages.emplace_back(temp1.day(),
+                             temp1.month(),
+                             temp1.year(),
+                             (PlannerBase*)NULL,
+                             this,
+                             _page_height,
+                             _page_width,
+                             std::move(day_page_title),
+                             day_grid_title,
+                             _margin_width,
+                             _is_left_handed,
+                             _is_portrait,
+                             _time_in_margin,
+                             _time_gap_lines,
+                             _time_start);
+      day_pages.back().SetPageCache(_page_cache);
+      day_pages.back().SetPdfWriter(_pdf_writer);
+      _days.push_back(&day_pages.back());
 
-      std::shared_ptr<PlannerBase> prev_day;
+      PlannerBase* prev_day = NULL;
 
       if (i > 1) {
         prev_day = _days[i - 2];
       } else {
         if (NULL != _left) {
-          prev_day =
-              std::static_pointer_cast<PlannerMonth>(_left)->GetDays().back();
+          prev_day = static_cast<PlannerMonth*>(_left)->GetDays().back();
         }
       }
 
@@ -136,14 +141,31 @@ public:
 
   void BuildDays(HPDF_Doc& doc) {
     for (auto day : _days) {
-      std::static_pointer_cast<PlannerDay>(day)->Build(doc);
+      static_cast<PlannerDay*>(day)->Build(doc);
+    }
+  }
+
+  /*!
+   * Create the page of the month followed by the pages of its days, which
+   * have the size of the month, in the order Build and BuildDays create them
+   */
+  void CreatePages(HPDF_Doc& doc) {
+    CreatePage(doc, _page_height, _page_width);
+    for (auto day : _days) {
+      day->CreatePage(doc, _page_height, _page_width);
+    }
+  }
+
+  void RecordDays(HPDF_Doc& doc) {
+    for (auto day : _days) {
+      static_cast<PlannerDay*>(day)->Record(doc);
     }
   }
   /*!
    * Function to create the weekday name header
    */
   void CreateWeekdayHeader(HPDF_Doc& doc,
-                           HPDF_Page& page,
+                           PlannerDisplayList& display_list,
                            HPDF_REAL x_start,
                            HPDF_REAL y_start,
                            HPDF_REAL x_stop,
@@ -151,39 +173,58 @@ public:
                            bool create_thumbnail,
                            HPDF_REAL padding,
                            bool first_letter_only) {
-    std::vector<std::shared_ptr<PlannerBase>> weekdays;
-    date::weekday weekday;
-    for (size_t i = 0; i < 7; i++) {
-      weekday = (date::weekday)((i + _first_day_of_week) % 7);
-      std::string weekday_name = format("%a", weekday);
-      if (true == first_letter_only) {
-        weekday_name = weekday_name.substr(0, 1);
-      }
-      weekdays.push_back(std::make_shared<PlannerBase>(
-          PlannerBase(weekday_name, _is_left_handed)));
-    }
+    /* The header is the same for every month with the same layout */
+    std::string fragment_key =
+        "weekdays_" + std::to_string(_first_day_of_week) + "_" +
+        std::to_string(first_letter_only) + "_" +
+        std::to_string(x_stop - x_start) + "_" +
+        std::to_string(y_stop - y_start) + "_" + std::to_string(padding) +
+        "_" + std::to_string(_page_height);
+
+    StampGridFragment(
+        display_list,
+        fragment_key,
+        x_start,
+        y_start,
+        {},
+        [&](PlannerDisplayList& grid) {
+          std::vector<PlannerBase> weekday_pages;
+          std::vector<PlannerBase*> weekdays;
+          date::weekday weekday;
+          weekday_pages.reserve(7);
+          for (size_t i = 0; i < 7; i++) {
+            weekday = (date::weekday)((i + _first_day_of_week) % 7);
+            std::string weekday_name =
+                PlannerCalendarStrings::WeekdayName(weekday);
+            if (true == first_letter_only) {
+              weekday_name = weekday_name.substr(0, 1);
+            }
+            weekday_pages.emplace_back(weekday_name, _is_left_handed);
+            weekdays.push_back(&weekday_pages.back());
+          }
 
-    CreateGrid(doc,
-               page,
-               x_start,
-               y_start,
-               x_stop,
-               y_stop,
-               1,
-               7,
-               weekdays,
-               false,
-               0,
-               create_thumbnail,
-               PlannerTypes_Month,
-               PlannerTypes_Day,
-               _page_height,
-               padding,
-               true);
+          CreateGrid(doc,
+                     grid,
+                     0,
+                     0,
+                     x_stop - x_start,
+                     y_stop - y_start,
+                     1,
+                     7,
+                     weekdays,
+                     false,
+                     0,
+                     create_thumbnail,
+                     PlannerTypes_Month,
+                     PlannerTypes_Day,
+                     _page_height,
+                     padding,
+                     true);
+        });
   }
 
   void AddDaysSection(HPDF_Doc& doc,
-                      HPDF_Page& page,
+                      PlannerDisplayList& display_list,
                       HPDF_REAL x_start,
                       HPDF_REAL y_start,
                       HPDF_REAL x_stop,
@@ -193,25 +234,46 @@ public:
 
     date::year_month_day first_day =
         date::year(_month.year()) / _month.month() / 1;
+    size_t first_entry_offset =
+        (date::weekday{first_day}.c_encoding() - _first_day_of_week + 7) % 7;
 
-    CreateGrid(
-        doc,
-        page,
+    /*
+     * The grid only depends on the weekday the month starts on and the
+     * number of days, so months of the same shape share one copy of it and
+     * only the links to the days are made for each month
+     */
+    std::string fragment_key =
+        "days_" + std::to_string(first_entry_offset) + "_" +
+        std::to_string(_days.size()) + "_" +
+        std::to_string(x_stop - x_start) + "_" +
+        std::to_string(y_stop - y_start) + "_" + std::to_string(padding) +
+        "_" + std::to_string(_page_height);
+
+    StampGridFragment(
+        display_list,
+        fragment_key,
         x_start,
         y_start,
-        x_stop,
-        y_stop,
-        6,
-        7,
         _days,
-        true,
-        (date::weekday{first_day}.c_encoding() - _first_day_of_week + 7) % 7,
-        create_thumbnail,
-        PlannerTypes_Month,
-        PlannerTypes_Day,
-        _page_height,
-        padding,
-        true);
+        [&](PlannerDisplayList& grid) {
+          CreateGrid(doc,
+                     grid,
+                     0,
+                     0,
+                     x_stop - x_start,
+                     y_stop - y_start,
+                     6,
+                     7,
+                     _days,
+                     true,
+                     first_entry_offset,
+                     create_thumbnail,
+                     PlannerTypes_Month,
+                     PlannerTypes_Day,
+                     _page_height,
+                     padding,
+                     true);
+        });
   }
 
   void CreateDaysSection(HPDF_Doc& doc) {
@@ -233,7 +295,7 @@ public:
       section_y_stop = _page_height;
     }
     CreateWeekdayHeader(doc,
-                        _page,
+                        _display_list,
                         section_x_start + 30,
                         section_y_start,
                         section_x_stop - 30,
@@ -242,7 +304,7 @@ public:
                         10,
                         false);
     AddDaysSection(doc,
-                   _page,
+                   _display_list,
                    section_x_start + 30,
                    section_y_start + (_note_title_font_size * 2),
                    section_x_stop - 30,
@@ -252,13 +314,13 @@ public:
   }
 
   void CreateThumbnail(HPDF_Doc& doc,
-                       HPDF_Page& page,
+                       PlannerDisplayList& display_list,
                        HPDF_REAL x_start,
                        HPDF_REAL y_start,
                        HPDF_REAL x_stop,
                        HPDF_REAL y_stop) {
     CreateWeekdayHeader(doc,
-                        page,
+                        display_list,
                         x_start,
                         y_start + 50,
                         x_stop,
@@ -266,21 +328,44 @@ public:
                         false,
                         2,
                         true);
-    AddDaysSection(doc, page, x_start, y_start + 100, x_stop, y_stop, false, 2);
+    AddDaysSection(
+        doc, display_list, x_start, y_start + 100, x_stop, y_stop, false, 2);
   }
 
   void CreateNavigation(HPDF_Doc& doc) {
-    AddNavigation();
+    if (false == _is_cached && false == _is_placeholder) {
+      AddNavigation();
+    }
     for (auto day : _days) {
-      std::static_pointer_cast<PlannerDay>(day)->CreateNavigation(doc);
+      static_cast<PlannerDay*>(day)->CreateNavigation(doc);
+    }
+  }
+
+  void FlushDisplayLists(HPDF_Doc& doc, DisplayListStats* stats = NULL) {
+    FlushDisplayList(doc, stats);
+    for (auto day : _days) {
+      static_cast<PlannerDay*>(day)->FlushDisplayList(doc, stats);
     }
   }
 
   void Build(HPDF_Doc& doc) {
     CreatePage(doc, _page_height, _page_width);
+    Record(doc);
+  }
+
+  /*!
+   * Record the operations of the page without touching the PDF document,
+   * the page itself is created by CreatePage
+   */
+  void Record(HPDF_Doc& doc) {
+    if (true == _is_placeholder ||
+        true == LoadFromPageCache(PlannerTypes_Month,
+                                      std::to_string(_first_day_of_week),
+                                      _days)) {
+      return;
+    }
+    StampPageTemplate(PlannerTypes_Month, false == _is_portrait);
     CreateTitle();
-    AddDays();
-    BuildDays(doc);
     CreateDaysSection(doc);
     if (false == _is_portrait) {
       CreateNotesSection(false);
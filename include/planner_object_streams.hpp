@@ -0,0 +1,326 @@
+#ifndef PLANNER_OBJECT_STREAMS_HPP
+#define PLANNER_OBJECT_STREAMS_HPP
+// The MIT License (MIT)
+//
+// Copyright (c) 2015, 2016, 2017 Howard Hinnant
+// Copyright (c) 2016 Adrian Colomitchi
+// Copyright (c) 2017 Florian Dang
+// Copyright (c) 2017 Paul Thompson
+// Copyright (c) 2018, 2019 Tomasz Kamiński
+// Copyright (c) 2019 Jiangang Zhuang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Our apologies.  When the previous paragraph was written, lowercase had not
+// yet been invented (that would involve another several millennia of
+// evolution). We did not mean to shout.
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+/*!
+ * @brief
+ * Rewrites a PDF saved by libharu into a PDF 1.5 file with object streams
+ * and a cross-reference stream. libharu only writes PDF 1.3 style files, so
+ * every small object such as a page, link annotation or stream length gets
+ * an uncompressed object of its own and a line in the cross-reference
+ * table. Here those objects are packed into compressed object streams and
+ * the table is replaced by a compressed cross-reference stream. Stream
+ * objects are copied as they are and keep their object numbers.
+ */
+class PlannerObjectStreams {
+  /*! The number of objects packed into each object stream */
+  static const size_t Objects_per_stream = 100;
+
+  /*! An object of the original file */
+  struct PdfObject {
+    std::uint32_t number;
+    std::uint32_t generation;
+    size_t offset;
+    /*! Start and end of the whole object, from its number to endobj */
+    size_t start;
+    size_t end;
+    /*! Start and end of the value between obj and endobj */
+    size_t value_start;
+    size_t value_end;
+    bool is_stream;
+  };
+
+  static bool IsSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\f' ||
+           c == '\0';
+  }
+
+  static bool Compress(const std::string& data, std::string& compressed) {
+    uLongf size = compressBound(data.size());
+    compressed.resize(size);
+    if (Z_OK != compress2((Bytef*)&compressed[0],
+                          &size,
+                          (const Bytef*)data.data(),
+                          data.size(),
+                          Z_DEFAULT_COMPRESSION)) {
+      return false;
+    }
+    compressed.resize(size);
+    return true;
+  }
+
+  static void AppendStream(std::string& out,
+                           std::uint32_t number,
+                           const std::string& dictionary,
+                           const std::string& data) {
+    out += std::to_string(number) + " 0 obj\n<<\n" + dictionary +
+           "/Filter /FlateDecode\n/Length " + std::to_string(data.size()) +
+           "\n>>\nstream\r\n" + data + "\r\nendstream\nendobj\n";
+  }
+
+  /*! Append value as a big endian number of the given width in bytes */
+  static void AppendField(std::string& out, std::uint64_t value, int width) {
+    for (int shift = (width - 1) * 8; shift >= 0; shift -= 8) {
+      out += (char)((value >> shift) & 0xff);
+    }
+  }
+
+  /*!
+   * Read the cross-reference table and the trailer dictionary of the file,
+   * only files with a single classic table, as libharu writes, are read
+   */
+  static bool ReadXref(const std::string& pdf,
+                       std::vector<PdfObject>& objects,
+                       std::uint32_t& size,
+                       size_t& xref_offset,
+                       std::string& trailer) {
+    size_t startxref = pdf.rfind("startxref");
+    if (startxref == std::string::npos) {
+      return false;
+    }
+    xref_offset = strtoull(pdf.c_str() + startxref + 9, NULL, 10);
+    if (xref_offset >= pdf.size() || pdf.compare(xref_offset, 4, "xref")) {
+      return false;
+    }
+
+    const char* position = pdf.c_str() + xref_offset + 4;
+    while (true) {
+      char* end;
+      std::uint32_t first = strtoul(position, &end, 10);
+      if (end == position) {
+        break;
+      }
+      std::uint32_t count = strtoul(end, &end, 10);
+      position = end;
+      for (std::uint32_t index = 0; index < count; index++) {
+        PdfObject object = {};
+        object.number = first + index;
+        object.offset = strtoull(position, &end, 10);
+        object.generation = strtoul(end, &end, 10);
+        while (IsSpace(*end)) {
+          end++;
+        }
+        if (*end != 'n' && *end != 'f') {
+          return false;
+        }
+        if (*end == 'n') {
+          objects.push_back(object);
+        }
+        position = end + 1;
+      }
+      size = std::max(size, first + count);
+    }
+
+    size_t trailer_start = pdf.find("<<", position - pdf.c_str());
+    size_t trailer_end = pdf.rfind(">>", startxref);
+    if (trailer_start == std::string::npos ||
+        trailer_end == std::string::npos || trailer_end < trailer_start) {
+      return false;
+    }
+    trailer = pdf.substr(trailer_start + 2, trailer_end - trailer_start - 2);
+    return true;
+  }
+
+  /*!
+   * Remove an entry with a single number value from the trailer, it is
+   * written again for the new file
+   */
+  static void RemoveTrailerEntry(std::string& trailer, const std::string& key) {
+    size_t entry = trailer.find(key);
+    if (entry == std::string::npos) {
+      return;
+    }
+    size_t end = entry + key.size();
+    while (end < trailer.size() &&
+           (IsSpace(trailer[end]) || isdigit((unsigned char)trailer[end]))) {
+      end++;
+    }
+    trailer.erase(entry, end - entry);
+  }
+
+  /*! Find where every object starts and ends and whether it is a stream */
+  static bool ReadObjects(const std::string& pdf,
+                          std::vector<PdfObject>& objects,
+                          size_t xref_offset) {
+    std::sort(objects.begin(),
+              objects.end(),
+              [](const PdfObject& a, const PdfObject& b) {
+                return a.offset < b.offset;
+              });
+    for (size_t index = 0; index < objects.size(); index++) {
+      PdfObject& object = objects[index];
+      size_t next = (index + 1 < objects.size()) ? objects[index + 1].offset
+                                                 : xref_offset;
+      std::string header = std::to_string(object.number) + " " +
+                           std::to_string(object.generation) + " obj";
+      if (next > pdf.size() || object.offset >= next ||
+          pdf.compare(object.offset, header.size(), header)) {
+        std::cout << "[ERR] : Object " << object.number
+                  << " is not where the cross-reference table says"
+                  << std::endl;
+        return false;
+      }
+      size_t endobj = pdf.rfind("endobj", next - 1);
+      if (endobj == std::string::npos || endobj < object.offset) {
+        return false;
+      }
+      object.start = object.offset;
+      object.end = endobj + 6;
+      object.value_start = object.offset + header.size();
+      object.value_end = endobj;
+      while (object.value_start < object.value_end &&
+             IsSpace(pdf[object.value_start])) {
+        object.value_start++;
+      }
+      while (object.value_end > object.value_start &&
+             IsSpace(pdf[object.value_end - 1])) {
+        object.value_end--;
+      }
+      object.is_stream =
+          (object.value_end - object.value_start >= 9) &&
+          (0 == pdf.compare(object.value_end - 9, 9, "endstream"));
+    }
+    return true;
+  }
+
+public:
+  /*!
+   * Pack the objects of pdf, a file written by libharu, into object streams
+   * with a cross-reference stream. Returns false, leaving packed untouched,
+   * if the file is not laid out as expected.
+   */
+  static bool Pack(const std::string& pdf, std::string& packed) {
+    std::vector<PdfObject> objects;
+    std::uint32_t size = 0;
+    size_t xref_offset;
+    std::string trailer;
+    if (false == ReadXref(pdf, objects, size, xref_offset, trailer) ||
+        objects.empty() || false == ReadObjects(pdf, objects, xref_offset)) {
+      std::cout << "[ERR] : Unable to read the document to pack its objects"
+                << std::endl;
+      return false;
+    }
+    /* The strings of an encrypted file are encrypted per object */
+    if (trailer.find("/Encrypt") != std::string::npos) {
+      std::cout << "[ERR] : Objects of encrypted documents are not packed"
+                << std::endl;
+      return false;
+    }
+    RemoveTrailerEntry(trailer, "/Size");
+    RemoveTrailerEntry(trailer, "/Prev");
+
+    /* Type, offset or object stream, generation or index of each object */
+    struct XrefEntry {
+      std::uint8_t type;
+      std::uint64_t field2;
+      std::uint32_t field3;
+    };
+    std::vector<XrefEntry> xref(size, {0, 0, 0});
+    xref[0] = {0, 0, 65535};
+
+    std::string out;
+    out.reserve(pdf.size());
+    /* Keep the binary comment line of the header */
+    out = "%PDF-1.5";
+    out.append(pdf, 8, objects.front().offset - 8);
+
+    std::vector<const PdfObject*> packable;
+    for (const PdfObject& object : objects) {
+      if (true == object.is_stream || 0 != object.generation) {
+        xref[object.number] = {1, out.size(), object.generation};
+        out.append(pdf, object.start, object.end - object.start);
+        out += "\n";
+      } else {
+        packable.push_back(&object);
+      }
+    }
+
+    std::uint32_t next_number = size;
+    for (size_t first = 0; first < packable.size();
+         first += Objects_per_stream) {
+      size_t last = std::min(first + Objects_per_stream, packable.size());
+      std::uint32_t stream_number = next_number++;
+      std::string offsets;
+      std::string values;
+      for (size_t index = first; index < last; index++) {
+        const PdfObject& object = *packable[index];
+        offsets += std::to_string(object.number) + " " +
+                   std::to_string(values.size()) + " ";
+        values.append(pdf, object.value_start,
+                      object.value_end - object.value_start);
+        values += "\n";
+        xref[object.number] = {2, stream_number, (std::uint32_t)(index - first)};
+      }
+      std::string compressed;
+      if (false == Compress(offsets + values, compressed)) {
+        return false;
+      }
+      xref.push_back({1, out.size(), 0});
+      AppendStream(out,
+                   stream_number,
+                   "/Type /ObjStm\n/N " + std::to_string(last - first) +
+                       "\n/First " + std::to_string(offsets.size()) + "\n",
+                   compressed);
+    }
+
+    /* The cross-reference stream lists itself as well */
+    std::uint32_t xref_number = next_number++;
+    size_t xref_stream_offset = out.size();
+    xref.push_back({1, xref_stream_offset, 0});
+    std::string rows;
+    for (const XrefEntry& entry : xref) {
+      AppendField(rows, entry.type, 1);
+      AppendField(rows, entry.field2, 4);
+      AppendField(rows, entry.field3, 2);
+    }
+    std::string compressed;
+    if (false == Compress(rows, compressed)) {
+      return false;
+    }
+    AppendStream(out,
+                 xref_number,
+                 "/Type /XRef\n/Size " + std::to_string(next_number) +
+                     "\n/W [ 1 4 2 ]\n" + trailer,
+                 compressed);
+    out += "startxref\n" + std::to_string(xref_stream_offset) + "\n%%EOF\n";
+    packed.swap(out);
+    return true;
+  }
+};
+#endif // PLANNER_OBJECT_STREAMS_HPP
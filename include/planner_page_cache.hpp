@@ -0,0 +1,430 @@
+#ifndef PLANNER_PAGE_CACHE_HPP
+#define PLANNER_PAGE_CACHE_HPP
+// The MIT License (MIT)
+//
+// Copyright (c) 2015, 2016, 2017 Howard Hinnant
+// Copyright (c) 2016 Adrian Colomitchi
+// Copyright (c) 2017 Florian Dang
+// Copyright (c) 2017 Paul Thompson
+// Copyright (c) 2018, 2019 Tomasz Kamiński
+// Copyright (c) 2019 Jiangang Zhuang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Our apologies.  When the previous paragraph was written, lowercase had not
+// yet been invented (that would involve another several millennia of
+// evolution). We did not mean to shout.
+#include "planner_pdf_writer.hpp"
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*!
+ * @brief
+ * On disk cache of the pages as PlannerPdfWriter wrote them, addressed by a
+ * hash of everything the page is drawn from and the settings of the writer.
+ * A page whose inputs did not change since an earlier run is written again
+ * from the cache instead of being recorded, serialized and compressed.
+ * Links are stored as an index into the list of pages the page can link
+ * to, so a cached page links to the objects of the current run. Shared
+ * streams are stored once under their key.
+ *
+ * The cache is a single file in the cache directory, read when the cache is
+ * opened and written back by Save. Pages can be looked up and stored from
+ * several threads.
+ */
+class PlannerPageCache {
+  /*! Changed whenever what is drawn or the file layout changes */
+  static constexpr std::uint32_t Format_version = 2;
+
+public:
+  /*! A written page as kept in the cache */
+  struct Page {
+    /*! The settings of the writer and everything the page is drawn from */
+    std::string inputs;
+    PlannerWrittenPage written_page;
+    /*! The index of the page every link navigates to among the pages the
+     * page can link to */
+    std::vector<std::uint32_t> link_targets;
+  };
+
+private:
+  std::string _directory;
+  /*! The settings of the writer the pages are written with */
+  std::string _writer_settings;
+  /*! The written pages by the hash of their inputs */
+  std::map<std::uint64_t, std::shared_ptr<const Page>> _pages;
+  /*! The written shared streams by their key */
+  std::map<std::string, PlannerWrittenStream> _shared_streams;
+  bool _is_modified;
+  std::uint64_t _hits;
+  std::uint64_t _misses;
+  mutable std::mutex _mutex;
+
+  /*! 64 bit FNV-1a hash */
+  static std::uint64_t Hash(const std::string& text) {
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char c : text) {
+      hash ^= c;
+      hash *= 0x100000001b3ULL;
+    }
+    return hash;
+  }
+
+  std::string GetPath() const { return _directory + "/pages.cache"; }
+
+  template <typename T> static void Write(std::string& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  static void WriteString(std::string& out, const std::string& text) {
+    Write(out, (std::uint32_t)text.size());
+    out.append(text);
+  }
+
+  /*! Reads values from a recorded string, failing once it runs out */
+  struct Reader {
+    const std::string& data;
+    size_t position;
+
+    template <typename T> bool Read(T& value) {
+      if (data.size() - position < sizeof(value)) {
+        return false;
+      }
+      memcpy(&value, data.data() + position, sizeof(value));
+      position += sizeof(value);
+      return true;
+    }
+
+    bool ReadString(std::string& text) {
+      std::uint32_t size;
+      if (false == Read(size) || data.size() - position < size) {
+        return false;
+      }
+      text.assign(data, position, size);
+      position += size;
+      return true;
+    }
+  };
+
+  static void WriteStream(std::string& out,
+                          const PlannerWrittenStream& stream) {
+    WriteString(out, stream.object);
+    Write(out, stream.text_runs);
+    Write(out, stream.path_ops);
+  }
+
+  static bool ReadStream(Reader& in, PlannerWrittenStream& stream) {
+    return in.ReadString(stream.object) && in.Read(stream.text_runs) &&
+           in.Read(stream.path_ops);
+  }
+
+  static void WritePage(std::string& out, const Page& page) {
+    WriteString(out, page.inputs);
+    Write(out, page.written_page.text_runs);
+    Write(out, page.written_page.path_ops);
+    Write(out, (std::uint32_t)page.written_page.parts.size());
+    size_t link_index = 0;
+    for (const PlannerWrittenPage::Part& part : page.written_page.parts) {
+      Write(out, (std::uint8_t)part.type);
+      if (PlannerWrittenPage::PartType_Link == part.type) {
+        Write(out, part.x_start);
+        Write(out, part.y_start);
+        Write(out, part.x_stop);
+        Write(out, part.y_stop);
+        Write(out, page.link_targets[link_index++]);
+      } else {
+        WriteString(out, part.data);
+      }
+    }
+  }
+
+  static bool ReadPage(Reader& in, Page& page) {
+    PlannerWrittenPage& written_page = page.written_page;
+    std::uint32_t num_parts;
+    if (false == (in.ReadString(page.inputs) &&
+                  in.Read(written_page.text_runs) &&
+                  in.Read(written_page.path_ops) && in.Read(num_parts))) {
+      return false;
+    }
+    written_page.parts.reserve(num_parts);
+    for (std::uint32_t part_index = 0; part_index < num_parts; part_index++) {
+      PlannerWrittenPage::Part part = {
+          PlannerWrittenPage::PartType_Stream, "", 0, 0, 0, 0, NULL};
+      std::uint8_t type;
+      if (false == in.Read(type) || type > PlannerWrittenPage::PartType_Link) {
+        return false;
+      }
+      part.type = (PlannerWrittenPage::PartType)type;
+      if (PlannerWrittenPage::PartType_Link == part.type) {
+        std::uint32_t target_index;
+        if (false == (in.Read(part.x_start) && in.Read(part.y_start) &&
+                      in.Read(part.x_stop) && in.Read(part.y_stop) &&
+                      in.Read(target_index))) {
+          return false;
+        }
+        page.link_targets.push_back(target_index);
+      } else if (false == in.ReadString(part.data)) {
+        return false;
+      }
+      written_page.parts.push_back(std::move(part));
+    }
+    return true;
+  }
+
+  const PlannerWrittenStream* Find(const std::string& key) const {
+    auto shared_it = _shared_streams.find(_writer_settings + key);
+    if (shared_it == _shared_streams.end()) {
+      return NULL;
+    }
+    return &shared_it->second;
+  }
+
+  /*! Read the cache file, an unreadable or outdated file is ignored */
+  void ReadFile() {
+    std::ifstream file(GetPath(), std::ios::binary | std::ios::ate);
+    std::string data;
+    if (false == file.is_open()) {
+      return;
+    }
+    data.resize(file.tellg());
+    file.seekg(0);
+    if (false == (bool)file.read(&data[0], data.size())) {
+      return;
+    }
+    Reader in = {data, 0};
+    std::uint32_t version;
+    std::uint32_t num_shared_streams;
+    std::uint32_t num_pages;
+    if (false == in.Read(version) || version != Format_version ||
+        false == in.Read(num_shared_streams)) {
+      return;
+    }
+    for (std::uint32_t index = 0; index < num_shared_streams; index++) {
+      std::string key;
+      PlannerWrittenStream stream;
+      if (false == in.ReadString(key) || false == ReadStream(in, stream)) {
+        _shared_streams.clear();
+        return;
+      }
+      _shared_streams[key] = std::move(stream);
+    }
+    if (false == in.Read(num_pages)) {
+      _shared_streams.clear();
+      return;
+    }
+    for (std::uint32_t index = 0; index < num_pages; index++) {
+      auto page = std::make_shared<Page>();
+      if (false == ReadPage(in, *page)) {
+        _shared_streams.clear();
+        _pages.clear();
+        return;
+      }
+      _pages[Hash(page->inputs)] = page;
+    }
+  }
+
+public:
+  /*! A cache in the given directory, an empty directory disables it */
+  PlannerPageCache(const std::string& directory = "")
+      : _is_modified(false), _hits(0), _misses(0) {
+    Open(directory);
+  }
+
+  /*!
+   * Use the cache in directory instead, dropping what was loaded or stored
+   * so far. An empty directory disables the cache.
+   */
+  void Open(const std::string& directory) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _directory = directory;
+    _pages.clear();
+    _shared_streams.clear();
+    _is_modified = false;
+    _hits = 0;
+    _misses = 0;
+    if (false == _directory.empty()) {
+      std::error_code create_error;
+      std::filesystem::create_directories(_directory, create_error);
+      if (create_error) {
+        std::cout << "[ERR] : Unable to create page cache directory : "
+                  << _directory << ", the cache is disabled" << std::endl;
+        _directory.clear();
+        return;
+      }
+      ReadFile();
+    }
+  }
+
+  bool IsEnabled() const { return false == _directory.empty(); }
+
+  /*!
+   * Set the settings of the writer the pages are written with, see
+   * PlannerPdfWriter::GetSettings. Pages and shared streams are only found
+   * when they were written with the same settings.
+   */
+  void SetWriterSettings(const std::string& writer_settings) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _writer_settings = writer_settings + "|";
+  }
+
+  std::uint64_t GetHits() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _hits;
+  }
+
+  std::uint64_t GetMisses() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _misses;
+  }
+
+  /*!
+   * Get the page drawn from inputs as it was written, NULL if it is not
+   * cached. num_link_targets is the number of pages the page can link to.
+   */
+  std::shared_ptr<const Page> Load(const std::string& inputs,
+                                   size_t num_link_targets) {
+    if (false == IsEnabled()) {
+      return NULL;
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::string key = _writer_settings + inputs;
+    auto page_it = _pages.find(Hash(key));
+    /* The inputs are kept with the page to rule out hash collisions */
+    if (page_it == _pages.end() || page_it->second->inputs != key) {
+      _misses++;
+      return NULL;
+    }
+    for (std::uint32_t target_index : page_it->second->link_targets) {
+      if (target_index >= num_link_targets) {
+        _misses++;
+        return NULL;
+      }
+    }
+    for (const PlannerWrittenPage::Part& part :
+         page_it->second->written_page.parts) {
+      if (PlannerWrittenPage::PartType_Shared == part.type &&
+          NULL == Find(part.data)) {
+        _misses++;
+        return NULL;
+      }
+    }
+    _hits++;
+    return page_it->second;
+  }
+
+  /*! The shared stream stored under key, NULL if there is none */
+  const PlannerWrittenStream* FindSharedStream(const std::string& key) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return Find(key);
+  }
+
+  /*!
+   * Store the page drawn from inputs as pdf_writer wrote it, with the
+   * shared streams it uses. Nothing is stored if a link points to a page
+   * that is not one of link_targets.
+   */
+  void Store(const std::string& inputs,
+             PlannerWrittenPage written_page,
+             const std::vector<PlannerBase*>& link_targets,
+             const PlannerPdfWriter& pdf_writer) {
+    if (false == IsEnabled()) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto page = std::make_shared<Page>();
+    page->inputs = _writer_settings + inputs;
+    page->written_page = std::move(written_page);
+    for (PlannerWrittenPage::Part& part : page->written_page.parts) {
+      if (PlannerWrittenPage::PartType_Link == part.type) {
+        std::uint32_t target_index = 0;
+        while (target_index < link_targets.size() &&
+               link_targets[target_index] != part.target) {
+          target_index++;
+        }
+        if (target_index == link_targets.size()) {
+          return;
+        }
+        page->link_targets.push_back(target_index);
+        part.target = NULL;
+      } else if (PlannerWrittenPage::PartType_Shared == part.type &&
+                 NULL == Find(part.data)) {
+        const PlannerWrittenStream* shared =
+            pdf_writer.FindSharedStream(part.data);
+        if (NULL == shared) {
+          return;
+        }
+        _shared_streams[_writer_settings + part.data] = *shared;
+      }
+    }
+    _pages[Hash(page->inputs)] = page;
+    _is_modified = true;
+  }
+
+  /*!
+   * Write the cache back to its directory if pages were stored. The file is
+   * written to a temporary file first so that a reader never sees half a
+   * cache.
+   */
+  void Save() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (false == IsEnabled() || false == _is_modified) {
+      return;
+    }
+    std::string data;
+    Write(data, Format_version);
+    Write(data, (std::uint32_t)_shared_streams.size());
+    for (auto& shared_stream : _shared_streams) {
+      WriteString(data, shared_stream.first);
+      WriteStream(data, shared_stream.second);
+    }
+    Write(data, (std::uint32_t)_pages.size());
+    for (auto& page : _pages) {
+      WritePage(data, *page.second);
+    }
+
+    std::string path = GetPath();
+    std::string temp_path = path + ".tmp";
+    bool is_written;
+    {
+      std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+      file.write(data.data(), data.size());
+      is_written = (bool)file;
+    }
+    std::error_code rename_error;
+    if (true == is_written) {
+      std::filesystem::rename(temp_path, path, rename_error);
+    }
+    if (false == is_written || rename_error) {
+      std::cout << "[ERR] : Unable to write page cache : " << path
+                << std::endl;
+      std::filesystem::remove(temp_path, rename_error);
+      return;
+    }
+    _is_modified = false;
+  }
+};
+#endif // PLANNER_PAGE_CACHE_HPP
@@ -0,0 +1,547 @@
+#ifndef PLANNER_PDF_FILE_HPP
+#define PLANNER_PDF_FILE_HPP
+// The MIT License (MIT)
+//
+// Copyright (c) 2015, 2016, 2017 Howard Hinnant
+// Copyright (c) 2016 Adrian Colomitchi
+// Copyright (c) 2017 Florian Dang
+// Copyright (c) 2017 Paul Thompson
+// Copyright (c) 2018, 2019 Tomasz Kamiński
+// Copyright (c) 2019 Jiangang Zhuang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Our apologies.  When the previous paragraph was written, lowercase had not
+// yet been invented (that would involve another several millennia of
+// evolution). We did not mean to shout.
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+/*!
+ * @brief
+ * Reads the objects and the page tree of an existing PDF file with classic
+ * cross-reference tables, following the tables of its incremental updates.
+ * Only what is needed to add pages to a planner written by libharu is read:
+ * object values are kept as text and looked into with a small tokenizer.
+ */
+class PlannerPdfFile {
+public:
+  enum TokenKind {
+    Token_End,
+    Token_Name,
+    Token_Number,
+    Token_String,
+    Token_DictOpen,
+    Token_DictClose,
+    Token_ArrayOpen,
+    Token_ArrayClose,
+    Token_Keyword
+  };
+
+  /*! A token of the file, from start to end */
+  struct Token {
+    TokenKind kind;
+    size_t start;
+    size_t end;
+  };
+
+  /*! A reference to an indirect object found in a value */
+  struct Reference {
+    std::uint32_t number;
+    std::uint32_t generation;
+    size_t start;
+    size_t end;
+  };
+
+  /*! Where an object is in the file */
+  struct PdfObject {
+    std::uint32_t generation;
+    size_t offset;
+    /*! Start and end of the value between obj and endobj */
+    size_t value_start;
+    size_t value_end;
+    /*! End of the dictionary of a stream, the stream data follows it */
+    size_t dictionary_end;
+    bool is_stream;
+  };
+
+private:
+  std::string _pdf;
+  /*! The in use objects of the newest cross-reference sections */
+  std::map<std::uint32_t, PdfObject> _objects;
+  /*! The trailer dictionary of the newest section */
+  std::string _trailer;
+  std::uint32_t _size;
+  size_t _startxref;
+
+  static bool IsSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\f' ||
+           c == '\0';
+  }
+
+  static bool IsDelimiter(char c) {
+    return c == '(' || c == ')' || c == '<' || c == '>' || c == '[' ||
+           c == ']' || c == '{' || c == '}' || c == '/' || c == '%';
+  }
+
+  /*!
+   * Read one cross-reference section and its trailer at offset. Entries
+   * already read from a newer section are kept.
+   */
+  bool ReadXrefSection(size_t offset,
+                       std::set<std::uint32_t>& seen,
+                       std::string& trailer) {
+    if (offset >= _pdf.size() || _pdf.compare(offset, 4, "xref")) {
+      std::cout << "[ERR] : Only files with cross-reference tables can be "
+                   "read, not cross-reference streams"
+                << std::endl;
+      return false;
+    }
+    const char* position = _pdf.c_str() + offset + 4;
+    while (true) {
+      char* end;
+      std::uint32_t first = strtoul(position, &end, 10);
+      if (end == position) {
+        break;
+      }
+      std::uint32_t count = strtoul(end, &end, 10);
+      position = end;
+      for (std::uint32_t index = 0; index < count; index++) {
+        PdfObject object = {};
+        object.offset = strtoull(position, &end, 10);
+        object.generation = strtoul(end, &end, 10);
+        while (IsSpace(*end)) {
+          end++;
+        }
+        if (*end != 'n' && *end != 'f') {
+          return false;
+        }
+        std::uint32_t number = first + index;
+        if (true == seen.insert(number).second && *end == 'n') {
+          _objects[number] = object;
+        }
+        position = end + 1;
+      }
+    }
+    size_t trailer_start = position - _pdf.c_str();
+    Token token = NextToken(_pdf, trailer_start, _pdf.size());
+    if (token.kind != Token_Keyword ||
+        _pdf.compare(token.start, token.end - token.start, "trailer")) {
+      return false;
+    }
+    token = NextToken(_pdf, token.end, _pdf.size());
+    size_t trailer_end = SkipValue(_pdf, token.start, _pdf.size());
+    if (token.kind != Token_DictOpen || trailer_end == std::string::npos) {
+      return false;
+    }
+    trailer = _pdf.substr(token.start, trailer_end - token.start);
+    return true;
+  }
+
+  /*! Find where the value of an object starts and ends */
+  bool LocateObject(std::uint32_t number, PdfObject& object) {
+    std::string header = std::to_string(number) + " " +
+                         std::to_string(object.generation) + " obj";
+    if (object.offset >= _pdf.size() ||
+        _pdf.compare(object.offset, header.size(), header)) {
+      return false;
+    }
+    Token token = NextToken(_pdf, object.offset + header.size(), _pdf.size());
+    object.value_start = token.start;
+    object.value_end = SkipValue(_pdf, token.start, _pdf.size());
+    object.dictionary_end = object.value_end;
+    if (object.value_end == std::string::npos) {
+      return false;
+    }
+    token = NextToken(_pdf, object.value_end, _pdf.size());
+    object.is_stream =
+        (token.kind == Token_Keyword &&
+         0 == _pdf.compare(token.start, token.end - token.start, "stream"));
+    if (true == object.is_stream) {
+      /* The data starts after the end of line following stream */
+      size_t data = token.end;
+      if (data < _pdf.size() && _pdf[data] == '\r') {
+        data++;
+      }
+      if (data < _pdf.size() && _pdf[data] == '\n') {
+        data++;
+      }
+      size_t length_end = std::string::npos;
+      std::string length = GetEntry(
+          _pdf.substr(object.value_start,
+                      object.dictionary_end - object.value_start),
+          "/Length");
+      std::uint32_t length_number;
+      if (true == GetReference(length, length_number)) {
+        /* The length is usually written after the stream */
+        auto length_object = _objects.find(length_number);
+        if (length_object != _objects.end() &&
+            true == LocateObject(length_number, length_object->second)) {
+          length = GetValue(length_number);
+        }
+      }
+      char* end;
+      size_t length_value = strtoull(length.c_str(), &end, 10);
+      if (end != length.c_str() && data + length_value <= _pdf.size()) {
+        length_end = data + length_value;
+      }
+      size_t endstream = _pdf.find(
+          "endstream", (length_end != std::string::npos) ? length_end : data);
+      if (endstream == std::string::npos) {
+        return false;
+      }
+      object.value_end = endstream + 9;
+    }
+    size_t endobj = _pdf.find("endobj", object.value_end);
+    return endobj != std::string::npos;
+  }
+
+public:
+  PlannerPdfFile() : _size(0), _startxref(0) {}
+
+  /*!
+   * Get the token starting at or after position, skipping white space and
+   * comments. The kind is Token_End at limit.
+   */
+  static Token NextToken(const std::string& text, size_t position,
+                         size_t limit) {
+    while (position < limit) {
+      if (true == IsSpace(text[position])) {
+        position++;
+      } else if (text[position] == '%') {
+        while (position < limit && text[position] != '\n' &&
+               text[position] != '\r') {
+          position++;
+        }
+      } else {
+        break;
+      }
+    }
+    Token token = {Token_End, position, position};
+    if (position >= limit) {
+      return token;
+    }
+    char c = text[position];
+    size_t end = position + 1;
+    if (c == '(') {
+      token.kind = Token_String;
+      int depth = 1;
+      while (end < limit && depth > 0) {
+        if (text[end] == '\\') {
+          end++;
+        } else if (text[end] == '(') {
+          depth++;
+        } else if (text[end] == ')') {
+          depth--;
+        }
+        end++;
+      }
+    } else if (c == '<' && end < limit && text[end] == '<') {
+      token.kind = Token_DictOpen;
+      end++;
+    } else if (c == '>' && end < limit && text[end] == '>') {
+      token.kind = Token_DictClose;
+      end++;
+    } else if (c == '<') {
+      token.kind = Token_String;
+      while (end < limit && text[end] != '>') {
+        end++;
+      }
+      end++;
+    } else if (c == '[') {
+      token.kind = Token_ArrayOpen;
+    } else if (c == ']') {
+      token.kind = Token_ArrayClose;
+    } else {
+      token.kind = (c == '/') ? Token_Name : Token_Number;
+      while (end < limit && false == IsSpace(text[end]) &&
+             false == IsDelimiter(text[end])) {
+        end++;
+      }
+      if (c != '/') {
+        for (size_t index = position; index < end; index++) {
+          if (false == isdigit((unsigned char)text[index]) &&
+              text[index] != '.' && text[index] != '-' &&
+              text[index] != '+') {
+            token.kind = Token_Keyword;
+            break;
+          }
+        }
+      }
+    }
+    token.end = std::min(end, limit);
+    return token;
+  }
+
+  /*!
+   * Get the end of the value starting at position, a reference counts as
+   * a single value. Returns npos if the value is not complete.
+   */
+  static size_t SkipValue(const std::string& text, size_t position,
+                          size_t limit) {
+    Token token = NextToken(text, position, limit);
+    if (token.kind == Token_DictOpen || token.kind == Token_ArrayOpen) {
+      int depth = 1;
+      size_t end = token.end;
+      while (depth > 0) {
+        token = NextToken(text, end, limit);
+        if (token.kind == Token_End) {
+          return std::string::npos;
+        }
+        if (token.kind == Token_DictOpen || token.kind == Token_ArrayOpen) {
+          depth++;
+        } else if (token.kind == Token_DictClose ||
+                   token.kind == Token_ArrayClose) {
+          depth--;
+        }
+        end = token.end;
+      }
+      return end;
+    }
+    if (token.kind == Token_End || token.kind == Token_DictClose ||
+        token.kind == Token_ArrayClose) {
+      return std::string::npos;
+    }
+    if (token.kind == Token_Number) {
+      Token generation = NextToken(text, token.end, limit);
+      Token keyword = NextToken(text, generation.end, limit);
+      if (generation.kind == Token_Number && keyword.kind == Token_Keyword &&
+          0 == text.compare(keyword.start, keyword.end - keyword.start, "R")) {
+        return keyword.end;
+      }
+    }
+    return token.end;
+  }
+
+  /*! Find every reference in text, strings are skipped */
+  static std::vector<Reference> GetReferences(const std::string& text) {
+    std::vector<Reference> references;
+    Token previous[2] = {{Token_End, 0, 0}, {Token_End, 0, 0}};
+    size_t position = 0;
+    while (true) {
+      Token token = NextToken(text, position, text.size());
+      if (token.kind == Token_End) {
+        break;
+      }
+      if (token.kind == Token_Keyword && previous[0].kind == Token_Number &&
+          previous[1].kind == Token_Number &&
+          0 == text.compare(token.start, token.end - token.start, "R")) {
+        references.push_back({(std::uint32_t)strtoul(
+                                  text.c_str() + previous[0].start, NULL, 10),
+                              (std::uint32_t)strtoul(
+                                  text.c_str() + previous[1].start, NULL, 10),
+                              previous[0].start,
+                              token.end});
+      }
+      previous[0] = previous[1];
+      previous[1] = token;
+      position = token.end;
+    }
+    return references;
+  }
+
+  /*!
+   * Find the value of key in the dictionary dictionary, returns false if the
+   * dictionary has no such entry
+   */
+  static bool FindEntry(const std::string& dictionary,
+                        const std::string& key,
+                        size_t& value_start,
+                        size_t& value_end) {
+    Token token = NextToken(dictionary, 0, dictionary.size());
+    if (token.kind != Token_DictOpen) {
+      return false;
+    }
+    size_t position = token.end;
+    while (true) {
+      token = NextToken(dictionary, position, dictionary.size());
+      if (token.kind != Token_Name) {
+        return false;
+      }
+      size_t end = SkipValue(dictionary, token.end, dictionary.size());
+      if (end == std::string::npos) {
+        return false;
+      }
+      if (0 == dictionary.compare(token.start, token.end - token.start, key)) {
+        value_start = NextToken(dictionary, token.end, end).start;
+        value_end = end;
+        return true;
+      }
+      position = end;
+    }
+  }
+
+  /*! Get the value of key in dictionary, empty if there is none */
+  static std::string GetEntry(const std::string& dictionary,
+                              const std::string& key) {
+    size_t value_start;
+    size_t value_end;
+    if (false == FindEntry(dictionary, key, value_start, value_end)) {
+      return "";
+    }
+    return dictionary.substr(value_start, value_end - value_start);
+  }
+
+  /*!
+   * Set the value of key in dictionary, adding the entry if it is not there.
+   * An empty value removes the entry.
+   */
+  static void SetEntry(std::string& dictionary,
+                       const std::string& key,
+                       const std::string& value) {
+    size_t value_start;
+    size_t value_end;
+    if (true == FindEntry(dictionary, key, value_start, value_end)) {
+      size_t key_start = dictionary.rfind(key, value_start);
+      if (true == value.empty()) {
+        dictionary.erase(key_start, value_end - key_start);
+      } else {
+        dictionary.replace(value_start, value_end - value_start, value);
+      }
+    } else if (false == value.empty()) {
+      size_t close = dictionary.rfind(">>");
+      if (close != std::string::npos) {
+        dictionary.insert(close, key + " " + value + "\n");
+      }
+    }
+  }
+
+  /*! Read a value made of a single reference */
+  static bool GetReference(const std::string& value, std::uint32_t& number) {
+    std::vector<Reference> references = GetReferences(value);
+    if (references.size() != 1 || references[0].start != 0 ||
+        references[0].end != value.size()) {
+      return false;
+    }
+    number = references[0].number;
+    return true;
+  }
+
+  /*!
+   * Read the file in pdf. Returns false if it has no readable classic
+   * cross-reference tables.
+   */
+  bool Read(const std::string& pdf) {
+    _pdf = pdf;
+    _objects.clear();
+    size_t startxref = _pdf.rfind("startxref");
+    if (startxref == std::string::npos) {
+      std::cout << "[ERR] : Unable to find the cross-reference table"
+                << std::endl;
+      return false;
+    }
+    _startxref = strtoull(_pdf.c_str() + startxref + 9, NULL, 10);
+    std::set<std::uint32_t> seen;
+    std::set<size_t> sections;
+    size_t offset = _startxref;
+    while (true == sections.insert(offset).second) {
+      std::string trailer;
+      if (false == ReadXrefSection(offset, seen, trailer)) {
+        return false;
+      }
+      if (true == _trailer.empty()) {
+        _trailer = trailer;
+        _size = strtoul(GetEntry(trailer, "/Size").c_str(), NULL, 10);
+      }
+      std::string previous = GetEntry(trailer, "/Prev");
+      if (true == previous.empty()) {
+        break;
+      }
+      offset = strtoull(previous.c_str(), NULL, 10);
+    }
+    for (auto& object : _objects) {
+      if (false == LocateObject(object.first, object.second)) {
+        std::cout << "[ERR] : Object " << object.first
+                  << " is not where the cross-reference table says"
+                  << std::endl;
+        return false;
+      }
+    }
+    return true;
+  }
+
+  const std::string& GetData() const { return _pdf; }
+
+  const std::string& GetTrailer() const { return _trailer; }
+
+  /*! The number of object numbers in use, as in the trailer */
+  std::uint32_t GetSize() const { return _size; }
+
+  /*! The offset of the newest cross-reference section */
+  size_t GetStartXref() const { return _startxref; }
+
+  const PdfObject* GetObject(std::uint32_t number) const {
+    auto object = _objects.find(number);
+    return (object == _objects.end()) ? NULL : &object->second;
+  }
+
+  /*!
+   * Get the value of an object, or of its dictionary only for a stream.
+   * Empty if there is no such object.
+   */
+  std::string GetValue(std::uint32_t number) const {
+    const PdfObject* object = GetObject(number);
+    if (NULL == object) {
+      return "";
+    }
+    return _pdf.substr(object->value_start,
+                       object->dictionary_end - object->value_start);
+  }
+
+  /*!
+   * Get the object numbers of the pages in document order. Returns false if
+   * the page tree cannot be followed.
+   */
+  bool GetPages(std::vector<std::uint32_t>& pages) const {
+    std::uint32_t root;
+    std::uint32_t page_tree;
+    if (false == GetReference(GetEntry(_trailer, "/Root"), root) ||
+        false == GetReference(GetEntry(GetValue(root), "/Pages"), page_tree)) {
+      return false;
+    }
+    std::set<std::uint32_t> visited;
+    std::vector<std::uint32_t> pending = {page_tree};
+    while (false == pending.empty()) {
+      std::uint32_t number = pending.back();
+      pending.pop_back();
+      if (false == visited.insert(number).second) {
+        return false;
+      }
+      std::string node = GetValue(number);
+      std::string type = GetEntry(node, "/Type");
+      if (type == "/Page") {
+        pages.push_back(number);
+      } else if (type == "/Pages") {
+        std::vector<Reference> kids = GetReferences(GetEntry(node, "/Kids"));
+        for (auto kid = kids.rbegin(); kid != kids.rend(); kid++) {
+          pending.push_back(kid->number);
+        }
+      } else {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+#endif // PLANNER_PDF_FILE_HPP
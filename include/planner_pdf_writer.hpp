@@ -0,0 +1,869 @@
+#ifndef PLANNER_PDF_WRITER_HPP
+#define PLANNER_PDF_WRITER_HPP
+// The MIT License (MIT)
+//
+// Copyright (c) 2015, 2016, 2017 Howard Hinnant
+// Copyright (c) 2016 Adrian Colomitchi
+// Copyright (c) 2017 Florian Dang
+// Copyright (c) 2017 Paul Thompson
+// Copyright (c) 2018, 2019 Tomasz Kamiński
+// Copyright (c) 2019 Jiangang Zhuang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Our apologies.  When the previous paragraph was written, lowercase had not
+// yet been invented (that would involve another several millennia of
+// evolution). We did not mean to shout.
+#include "planner_display_list.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+/*!
+ * Receives the saved document in consecutive chunks, returns false to stop
+ * writing
+ */
+using PlannerOutputSink =
+    std::function<bool(const HPDF_BYTE* data, HPDF_UINT32 size)>;
+
+/*!
+ * @brief
+ * A stream object as PlannerPdfWriter wrote it, with the text runs and path
+ * operators it holds
+ */
+struct PlannerWrittenStream {
+  /*! The stream object without the object number around it */
+  std::string object;
+  std::uint64_t text_runs = 0;
+  std::uint64_t path_ops = 0;
+};
+
+/*!
+ * @brief
+ * What PlannerPdfWriter wrote for a page, in the order it was written: the
+ * content streams, the shared streams it uses and its links. Written again
+ * with RewritePage it gives the same objects as the display list it was
+ * written from, without recording or compressing anything.
+ */
+struct PlannerWrittenPage {
+  enum PartType : std::uint8_t {
+    PartType_Stream,
+    PartType_Shared,
+    PartType_Link,
+  };
+
+  struct Part {
+    PartType type;
+    /*! The stream object of a stream, the key of a shared stream */
+    std::string data;
+    /*! The area of a link */
+    HPDF_REAL x_start;
+    HPDF_REAL y_start;
+    HPDF_REAL x_stop;
+    HPDF_REAL y_stop;
+    /*! The page a link navigates to */
+    PlannerBase* target;
+  };
+
+  std::vector<Part> parts;
+  /*! What the streams of the page hold, the shared streams not included */
+  std::uint64_t text_runs = 0;
+  std::uint64_t path_ops = 0;
+};
+
+/*!
+ * @brief
+ * A PDF writer for the few things planner pages are made of: stroked lines,
+ * filled rectangles, Helvetica text, links between pages and content shared
+ * between pages. It writes the recorded display lists straight into one
+ * output buffer reserved up front, numbers are formatted without going
+ * through printf and every object is written once, as soon as it is known,
+ * instead of being kept as a tree of objects until the document is saved.
+ * With a sink the buffer is handed on whenever it fills up, so only the
+ * page being written is held. The pages look the same as when written with
+ * libharu.
+ */
+class PlannerPdfWriter {
+  /*! Expected size of a page in the output, used to reserve the buffer */
+  static const size_t Bytes_per_page = 4096;
+  static const size_t Compressed_bytes_per_page = 1024;
+  /*! The output buffered before it is handed to the sink */
+  static const size_t Sink_bytes = 1024 * 1024;
+
+  /*! Object numbers of the objects every document has */
+  static const std::uint32_t Catalog_object = 1;
+  static const std::uint32_t Page_tree_object = 2;
+  static const std::uint32_t Info_object = 3;
+  static const std::uint32_t Font_object = 4;
+  static const std::uint32_t Resources_object = 5;
+
+  /*! What a page holds until it is written */
+  struct PageEntry {
+    std::uint32_t number;
+    HPDF_REAL width;
+    HPDF_REAL height;
+    /*! The object number of the destination showing the page, 0 if none */
+    std::uint32_t destination;
+    bool is_written;
+  };
+
+  /*! The graphics state as set by the operators written so far */
+  struct GraphicsState {
+    HPDF_REAL line_width = -1;
+    HPDF_REAL stroke_gray = -1;
+    HPDF_REAL fill_gray = -1;
+    HPDF_REAL font_size = -1;
+    int dash_on = -1;
+    int dash_off = -1;
+    bool path_open = false;
+  };
+
+  std::string _out;
+  /*! The output handed to the sink so far, which _out follows */
+  size_t _sunk_size;
+  PlannerOutputSink _sink;
+  bool _is_sink_failed;
+  /*! Offset of every object in the output by object number, 0 until
+   * written */
+  std::vector<size_t> _offsets;
+  std::vector<PageEntry> _pages;
+  /*! Pages under each intermediate node of the page tree, 0 for none */
+  HPDF_UINT _pages_per_node;
+  std::vector<std::uint32_t> _node_objects;
+  bool _is_compressed;
+  /*! The number of decimals coordinates are written with */
+  int _decimals;
+  /*! The shared content streams written so far, by key */
+  std::map<std::string, std::pair<std::uint32_t, PlannerWrittenStream>>
+      _shared_streams;
+  /*! What the shared streams first written by the current page hold */
+  DisplayListStats _shared_stats;
+  /*! Where the page being written is recorded to, NULL if it is not */
+  PlannerWrittenPage* _written_page;
+  /*! Buffers reused for every content stream */
+  std::string _content;
+  std::string _compressed;
+  std::string _object;
+  bool _is_finished;
+
+  std::uint32_t NewObject() {
+    _offsets.push_back(0);
+    return _offsets.size() - 1;
+  }
+
+  void BeginObject(std::uint32_t number) {
+    _offsets[number] = _sunk_size + _out.size();
+    AppendInteger(_out, number);
+    _out += " 0 obj\n";
+  }
+
+  void EndObject() { _out += "\nendobj\n"; }
+
+  /*! Hand the output to the sink once it fills the buffer, or if forced */
+  void Drain(bool is_forced) {
+    if (!_sink || (false == is_forced && _out.size() < Sink_bytes)) {
+      return;
+    }
+    if (false == _is_sink_failed && false == _out.empty()) {
+      _is_sink_failed = !_sink((const HPDF_BYTE*)_out.data(), _out.size());
+    }
+    _sunk_size += _out.size();
+    _out.clear();
+  }
+
+  static void AppendInteger(std::string& out, std::uint64_t value) {
+    char digits[24];
+    char* end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+    out.append(digits, end - digits);
+  }
+
+  static void AppendReference(std::string& out, std::uint32_t number) {
+    AppendInteger(out, number);
+    out += " 0 R";
+  }
+
+  void WriteObject(std::uint32_t number, const std::string& object) {
+    BeginObject(number);
+    _out += object;
+    EndObject();
+  }
+
+  /*! Format data as a stream object into object, compressed if set */
+  void FormatStream(std::string& object, const std::string& data) {
+    const std::string* stream = &data;
+    if (true == _is_compressed) {
+      uLongf size = compressBound(data.size());
+      _compressed.resize(size);
+      if (Z_OK == compress2((Bytef*)&_compressed[0],
+                            &size,
+                            (const Bytef*)data.data(),
+                            data.size(),
+                            Z_DEFAULT_COMPRESSION)) {
+        _compressed.resize(size);
+        stream = &_compressed;
+      }
+    }
+    object = "<<\n/Length ";
+    AppendInteger(object, stream->size());
+    if (stream == &_compressed) {
+      object += "\n/Filter /FlateDecode";
+    }
+    object += "\n>>\nstream\n";
+    object += *stream;
+    object += "\nendstream";
+  }
+
+  /*! The node of the page tree the page with id page_id is under */
+  std::uint32_t GetParent(std::uint32_t page_id) {
+    if (0 == _pages_per_node) {
+      return Page_tree_object;
+    }
+    size_t node = page_id / _pages_per_node;
+    while (_node_objects.size() <= node) {
+      _node_objects.push_back(NewObject());
+    }
+    return _node_objects[node];
+  }
+
+  std::uint32_t GetDestination(std::uint32_t page_id) {
+    PageEntry& page = _pages[page_id];
+    if (0 == page.destination) {
+      page.destination = NewObject();
+      BeginObject(page.destination);
+      _out += "[ ";
+      AppendReference(_out, page.number);
+      _out += " /Fit ]";
+      EndObject();
+    }
+    return page.destination;
+  }
+
+  /*! Write a string as a PDF literal string */
+  static void AppendText(std::string& out, const std::string& text) {
+    out += '(';
+    for (unsigned char c : text) {
+      if (c == '(' || c == ')' || c == '\\') {
+        out += '\\';
+        out += c;
+      } else if (c < 32 || c > 126) {
+        const char octal[] = {'\\',
+                              (char)('0' + (c >> 6)),
+                              (char)('0' + ((c >> 3) & 7)),
+                              (char)('0' + (c & 7))};
+        out.append(octal, 4);
+      } else {
+        out += c;
+      }
+    }
+    out += ')';
+  }
+
+  /*!
+   * Write the operators of display_list to content, the way WriteToPage
+   * writes them to a libharu page. With contents, templates are written as
+   * shared streams of their own: content is ended as a stream into contents
+   * before the shared stream is added. Without it templates are placed
+   * inline. Links are added to annotations.
+   */
+  void WriteOps(const PlannerDisplayList& display_list,
+                std::string& content,
+                std::vector<std::uint32_t>* contents,
+                std::uint32_t page_number,
+                std::vector<std::uint32_t>& annotations,
+                const std::function<std::uint32_t(PlannerBase*)>& get_target_page,
+                DisplayListStats* stats) {
+    GraphicsState state;
+    auto close_path = [&]() {
+      if (state.path_open) {
+        content += "S\n";
+        stats->path_ops++;
+        state.path_open = false;
+      }
+    };
+
+    for (const DrawOp& op : display_list.GetOps()) {
+      if (op.type != DrawOpType_Line) {
+        close_path();
+      }
+
+      switch (op.type) {
+      case DrawOpType_Line:
+        if (op.size != state.line_width || op.gray != state.stroke_gray ||
+            op.dash_on != state.dash_on || op.dash_off != state.dash_off) {
+          close_path();
+        }
+        if (op.size != state.line_width) {
+          AppendReal(content, op.size);
+          content += " w\n";
+          state.line_width = op.size;
+        }
+        if (op.gray != state.stroke_gray) {
+          AppendReal(content, op.gray);
+          content += " G\n";
+          state.stroke_gray = op.gray;
+        }
+        if (op.dash_on != state.dash_on || op.dash_off != state.dash_off) {
+          if (op.dash_on == 0) {
+            content += "[] 0 d\n";
+          } else {
+            content += "[";
+            AppendInteger(content, op.dash_on);
+            content += " ";
+            AppendInteger(content, op.dash_off);
+            content += "] 0 d\n";
+          }
+          state.dash_on = op.dash_on;
+          state.dash_off = op.dash_off;
+        }
+        AppendPoint(content, op.x_start, op.y_start);
+        content += " m\n";
+        AppendPoint(content, op.x_stop, op.y_stop);
+        content += " l\n";
+        stats->path_ops += 2;
+        state.path_open = true;
+        break;
+
+      case DrawOpType_Rect:
+        if (op.gray != state.fill_gray) {
+          AppendReal(content, op.gray);
+          content += " g\n";
+          state.fill_gray = op.gray;
+        }
+        AppendPoint(content, op.x_start, op.y_start);
+        content += ' ';
+        AppendPoint(content,
+                    PlannerDisplayList::Quantize(op.x_stop, _decimals) -
+                        PlannerDisplayList::Quantize(op.x_start, _decimals),
+                    PlannerDisplayList::Quantize(op.y_stop, _decimals) -
+                        PlannerDisplayList::Quantize(op.y_start, _decimals));
+        content += " re\nf\n";
+        stats->path_ops += 2;
+        break;
+
+      case DrawOpType_Text:
+        if (op.gray != state.fill_gray) {
+          AppendReal(content, op.gray);
+          content += " g\n";
+          state.fill_gray = op.gray;
+        }
+        if (op.size != state.font_size) {
+          content += "/F1 ";
+          AppendReal(content, op.size);
+          content += " Tf\n";
+          state.font_size = op.size;
+        }
+        content += "BT\n";
+        AppendPoint(content, op.x_start, op.y_start);
+        content += " Td\n";
+        AppendText(content, op.text);
+        content += " Tj\nET\n";
+        stats->text_runs++;
+        break;
+
+      case DrawOpType_Link:
+        /* Templates never link, only the links of the page are recorded */
+        if (NULL != _written_page && NULL != contents) {
+          _written_page->parts.push_back({PlannerWrittenPage::PartType_Link,
+                                          "",
+                                          op.x_start,
+                                          op.y_start,
+                                          op.x_stop,
+                                          op.y_stop,
+                                          op.target});
+        }
+        annotations.push_back(WriteLink(op.x_start,
+                                        op.y_start,
+                                        op.x_stop,
+                                        op.y_stop,
+                                        get_target_page(op.target),
+                                        page_number));
+        stats->links++;
+        break;
+
+      case DrawOpType_Template: {
+        bool is_moved = (0 != op.x_start) || (0 != op.y_start);
+        if (is_moved || NULL == contents) {
+          content += "q\n";
+        }
+        if (is_moved) {
+          content += "1 0 0 1 ";
+          AppendPoint(content, op.x_start, op.y_start);
+          content += " cm\n";
+        }
+        if (NULL == contents) {
+          WriteOps(*op.content,
+                   content,
+                   NULL,
+                   page_number,
+                   annotations,
+                   get_target_page,
+                   stats);
+        } else {
+          EndStream(content, *contents);
+          if (NULL != _written_page) {
+            _written_page->parts.push_back({PlannerWrittenPage::PartType_Shared,
+                                            op.text,
+                                            0,
+                                            0,
+                                            0,
+                                            0,
+                                            NULL});
+          }
+          contents->push_back(
+              GetSharedStream(op, page_number, annotations, get_target_page));
+        }
+        if (is_moved || NULL == contents) {
+          content += "Q\n";
+        }
+        break;
+      }
+      }
+    }
+    close_path();
+  }
+
+  /*! Write a link annotation to the page with id target_page_id */
+  std::uint32_t WriteLink(HPDF_REAL x_start,
+                          HPDF_REAL y_start,
+                          HPDF_REAL x_stop,
+                          HPDF_REAL y_stop,
+                          std::uint32_t target_page_id,
+                          std::uint32_t page_number) {
+    std::uint32_t destination = GetDestination(target_page_id);
+    std::uint32_t annotation = NewObject();
+    BeginObject(annotation);
+    _out += "<<\n/Type /Annot\n/Subtype /Link\n/Rect [ ";
+    AppendPoint(_out, x_start, y_start);
+    _out += ' ';
+    AppendPoint(_out, x_stop, y_stop);
+    _out += " ]\n/Dest ";
+    AppendReference(_out, destination);
+    _out += "\n/P ";
+    AppendReference(_out, page_number);
+    _out += "\n>>";
+    EndObject();
+    return annotation;
+  }
+
+  /*! Write content as a stream of the page, if there is any */
+  void EndStream(std::string& content, std::vector<std::uint32_t>& contents) {
+    if (false == content.empty()) {
+      contents.push_back(NewObject());
+      FormatStream(_object, content);
+      WriteObject(contents.back(), _object);
+      content.clear();
+      if (NULL != _written_page) {
+        _written_page->parts.push_back(
+            {PlannerWrittenPage::PartType_Stream, _object, 0, 0, 0, 0, NULL});
+      }
+    }
+  }
+
+  /*!
+   * Get the stream holding the content of a template, writing it the first
+   * time the template is used. The content is wrapped in a save/restore
+   * pair so it does not leak graphics state into the page.
+   */
+  std::uint32_t GetSharedStream(
+      const DrawOp& op,
+      std::uint32_t page_number,
+      std::vector<std::uint32_t>& annotations,
+      const std::function<std::uint32_t(PlannerBase*)>& get_target_page) {
+    auto shared_it = _shared_streams.find(op.text);
+    if (shared_it != _shared_streams.end()) {
+      return shared_it->second.first;
+    }
+    DisplayListStats stats;
+    std::string shared = "q\n";
+    WriteOps(*op.content,
+             shared,
+             NULL,
+             page_number,
+             annotations,
+             get_target_page,
+             &stats);
+    shared += "Q\n";
+    PlannerWrittenStream written = {"", stats.text_runs, stats.path_ops};
+    FormatStream(written.object, shared);
+    return AddSharedStream(op.text, written);
+  }
+
+  std::uint32_t AddSharedStream(const std::string& key,
+                                const PlannerWrittenStream& written) {
+    std::uint32_t number = NewObject();
+    WriteObject(number, written.object);
+    _shared_stats.text_runs += written.text_runs;
+    _shared_stats.path_ops += written.path_ops;
+    _shared_streams.emplace(key, std::make_pair(number, written));
+    return number;
+  }
+
+  /*!
+   * Write the page object of the page with id page_id, with its content
+   * streams and link annotations
+   */
+  void WritePageObject(std::uint32_t page_id,
+                       const std::vector<std::uint32_t>& contents,
+                       const std::vector<std::uint32_t>& annotations) {
+    PageEntry& page = _pages[page_id];
+    BeginObject(page.number);
+    _out += "<<\n/Type /Page\n/MediaBox [ 0 0 ";
+    AppendPoint(_out, page.width, page.height);
+    _out += " ]\n/Contents [ ";
+    for (std::uint32_t content : contents) {
+      AppendReference(_out, content);
+      _out += ' ';
+    }
+    _out += "]\n/Resources ";
+    AppendReference(_out, Resources_object);
+    _out += "\n/Parent ";
+    AppendReference(_out, GetParent(page_id));
+    if (false == annotations.empty()) {
+      _out += "\n/Annots [ ";
+      for (std::uint32_t annotation : annotations) {
+        AppendReference(_out, annotation);
+        _out += ' ';
+      }
+      _out += "]";
+    }
+    _out += "\n>>";
+    EndObject();
+    page.is_written = true;
+  }
+
+  /*! Add what the page and the shared streams it wrote first hold */
+  void AddStats(DisplayListStats* stats, const DisplayListStats& page_stats) {
+    if (NULL != stats) {
+      stats->links += page_stats.links;
+      stats->text_runs += page_stats.text_runs + _shared_stats.text_runs;
+      stats->path_ops += page_stats.path_ops + _shared_stats.path_ops;
+    }
+    _shared_stats = DisplayListStats();
+  }
+
+public:
+  /*!
+   * Start a document of about expected_pages pages. compression_mode are
+   * the HPDF_COMP_* flags, only the content streams are compressed.
+   */
+  PlannerPdfWriter(HPDF_UINT compression_mode,
+                   HPDF_UINT pages_per_node,
+                   size_t expected_pages)
+      : _sunk_size(0), _is_sink_failed(false),
+        _pages_per_node(pages_per_node),
+        _is_compressed(0 != (compression_mode & HPDF_COMP_TEXT)),
+        _decimals(PlannerDisplayList::Max_decimals), _written_page(NULL),
+        _is_finished(false) {
+    _out.reserve(expected_pages * (_is_compressed ? Compressed_bytes_per_page
+                                                  : Bytes_per_page));
+    _pages.reserve(expected_pages);
+    _offsets.reserve(expected_pages * 8);
+    _offsets.assign(Resources_object + 1, 0);
+    _out = "%PDF-1.3\n%\xb7\xbe\xad\xaa\n";
+
+    BeginObject(Info_object);
+    _out += "<<\n/Producer (Planner_PDF)\n>>";
+    EndObject();
+    BeginObject(Font_object);
+    _out += "<<\n/Type /Font\n/BaseFont /Helvetica\n/Subtype /Type1\n"
+            "/Encoding /StandardEncoding\n>>";
+    EndObject();
+    BeginObject(Resources_object);
+    _out += "<<\n/ProcSet [ /PDF /Text ]\n/Font <<\n/F1 ";
+    AppendReference(_out, Font_object);
+    _out += "\n>>\n>>";
+    EndObject();
+  }
+
+  /*!
+   * Append value rounded to decimals in its shortest fixed point notation:
+   * without trailing zeros and without the zero before the decimal point
+   */
+  static void AppendReal(std::string& out,
+                         HPDF_REAL value,
+                         int decimals = PlannerDisplayList::Max_decimals) {
+    static const std::int64_t scales[] = {1, 10, 100, 1000, 10000, 100000};
+    decimals = std::max(0, std::min(decimals, PlannerDisplayList::Max_decimals));
+    std::int64_t scale = scales[decimals];
+    std::int64_t scaled = std::llround((double)value * scale);
+    if (scaled < 0) {
+      out += '-';
+      scaled = -scaled;
+    }
+    std::int64_t integer = scaled / scale;
+    std::int64_t fraction = scaled % scale;
+    if (0 != integer || 0 == fraction) {
+      AppendInteger(out, integer);
+    }
+    if (0 != fraction) {
+      char digits[PlannerDisplayList::Max_decimals];
+      int length = decimals;
+      for (int index = decimals - 1; index >= 0; index--) {
+        digits[index] = '0' + fraction % 10;
+        fraction /= 10;
+      }
+      while (digits[length - 1] == '0') {
+        length--;
+      }
+      out += '.';
+      out.append(digits, length);
+    }
+  }
+
+  /*! Append a pair of coordinates rounded to the precision of the document */
+  void AppendPoint(std::string& out, HPDF_REAL x, HPDF_REAL y) {
+    AppendReal(out, x, _decimals);
+    out += ' ';
+    AppendReal(out, y, _decimals);
+  }
+
+  /*!
+   * Set the number of decimals coordinates are rounded to, see
+   * PlannerDisplayList::Quantize
+   */
+  void SetPrecision(int decimals) { _decimals = decimals; }
+
+  /*!
+   * Hand the document to sink as it is written instead of keeping it until
+   * Finish. Only a buffer of about Sink_bytes is kept.
+   */
+  void SetSink(const PlannerOutputSink& sink) {
+    _sink = sink;
+    std::string out;
+    out.reserve(Sink_bytes + Bytes_per_page);
+    out = _out;
+    _out.swap(out);
+    Drain(false);
+  }
+
+  /*! The size of the document written so far */
+  size_t GetSize() const { return _sunk_size + _out.size(); }
+
+  /*! Whether the sink, if any, took everything handed to it */
+  bool IsSunk() const { return false == _is_sink_failed; }
+
+  /*!
+   * The settings the written pages depend on. A page written with other
+   * settings cannot be written again with RewritePage.
+   */
+  std::string GetSettings() const {
+    return std::to_string(_is_compressed) + "," + std::to_string(_decimals);
+  }
+
+  /*!
+   * The shared stream written under key, NULL if no page used it so far
+   */
+  const PlannerWrittenStream* FindSharedStream(const std::string& key) const {
+    auto shared_it = _shared_streams.find(key);
+    if (shared_it == _shared_streams.end()) {
+      return NULL;
+    }
+    return &shared_it->second.second;
+  }
+
+  /*!
+   * Add a page to the end of the document and return its id. The page is
+   * written by WritePage, links to it can be written before that.
+   */
+  std::uint32_t AddPage(HPDF_REAL width, HPDF_REAL height) {
+    _pages.push_back({NewObject(), width, height, 0, false});
+    return _pages.size() - 1;
+  }
+
+  /*!
+   * Write the page with id page_id and the recorded operations on it.
+   * get_target_page gives the page id a link navigates to. Content shared
+   * between pages is written once, the first time it is used, and only
+   * referenced afterwards. What is written for the page is recorded to
+   * written_page, if given.
+   */
+  void WritePage(std::uint32_t page_id,
+                 const PlannerDisplayList& display_list,
+                 const std::function<std::uint32_t(PlannerBase*)>& get_target_page,
+                 DisplayListStats* stats = NULL,
+                 PlannerWrittenPage* written_page = NULL) {
+    DisplayListStats page_stats;
+    std::vector<std::uint32_t> contents;
+    std::vector<std::uint32_t> annotations;
+    _written_page = written_page;
+    WriteOps(display_list,
+             _content,
+             &contents,
+             _pages[page_id].number,
+             annotations,
+             get_target_page,
+             &page_stats);
+    EndStream(_content, contents);
+    _written_page = NULL;
+    WritePageObject(page_id, contents, annotations);
+    if (NULL != written_page) {
+      written_page->text_runs = page_stats.text_runs;
+      written_page->path_ops = page_stats.path_ops;
+    }
+    AddStats(stats, page_stats);
+    Drain(false);
+  }
+
+  /*!
+   * Write the page with id page_id as written_page was written, with the
+   * same objects in the same order as WritePage. get_link_page gives the
+   * page id the link with the given index navigates to. get_shared_stream
+   * gives the shared streams not written to this document yet, a shared
+   * stream it does not have is left out of the page.
+   */
+  void RewritePage(
+      std::uint32_t page_id,
+      const PlannerWrittenPage& written_page,
+      const std::function<std::uint32_t(size_t)>& get_link_page,
+      const std::function<const PlannerWrittenStream*(const std::string&)>&
+          get_shared_stream,
+      DisplayListStats* stats = NULL) {
+    DisplayListStats page_stats;
+    std::vector<std::uint32_t> contents;
+    std::vector<std::uint32_t> annotations;
+    for (const PlannerWrittenPage::Part& part : written_page.parts) {
+      switch (part.type) {
+      case PlannerWrittenPage::PartType_Stream:
+        contents.push_back(NewObject());
+        WriteObject(contents.back(), part.data);
+        break;
+
+      case PlannerWrittenPage::PartType_Shared: {
+        auto shared_it = _shared_streams.find(part.data);
+        if (shared_it != _shared_streams.end()) {
+          contents.push_back(shared_it->second.first);
+        } else if (const PlannerWrittenStream* shared =
+                       get_shared_stream(part.data)) {
+          contents.push_back(AddSharedStream(part.data, *shared));
+        }
+        break;
+      }
+
+      case PlannerWrittenPage::PartType_Link:
+        annotations.push_back(WriteLink(part.x_start,
+                                        part.y_start,
+                                        part.x_stop,
+                                        part.y_stop,
+                                        get_link_page(page_stats.links),
+                                        _pages[page_id].number));
+        page_stats.links++;
+        break;
+      }
+    }
+    WritePageObject(page_id, contents, annotations);
+    page_stats.text_runs = written_page.text_runs;
+    page_stats.path_ops = written_page.path_ops;
+    AddStats(stats, page_stats);
+    Drain(false);
+  }
+
+  /*!
+   * Write the page tree, the catalog and the cross-reference table and
+   * return the complete document. Pages that were added but not written
+   * are left empty. With a sink everything is handed to the sink and
+   * nothing is left to return.
+   */
+  const std::string& Finish() {
+    if (true == _is_finished) {
+      return _out;
+    }
+    for (std::uint32_t page_id = 0; page_id < _pages.size(); page_id++) {
+      if (false == _pages[page_id].is_written) {
+        WritePage(page_id, PlannerDisplayList(), [](PlannerBase*) {
+          return (std::uint32_t)0;
+        });
+      }
+    }
+
+    std::vector<std::uint32_t> kids;
+    for (size_t node = 0; node < _node_objects.size(); node++) {
+      size_t first = node * _pages_per_node;
+      size_t last = std::min(first + _pages_per_node, _pages.size());
+      BeginObject(_node_objects[node]);
+      _out += "<<\n/Type /Pages\n/Kids [ ";
+      for (size_t page_id = first; page_id < last; page_id++) {
+        AppendReference(_out, _pages[page_id].number);
+        _out += ' ';
+      }
+      _out += "]\n/Count ";
+      AppendInteger(_out, last - first);
+      _out += "\n/Parent ";
+      AppendReference(_out, Page_tree_object);
+      _out += "\n>>";
+      EndObject();
+      kids.push_back(_node_objects[node]);
+    }
+    if (0 == _pages_per_node) {
+      for (const PageEntry& page : _pages) {
+        kids.push_back(page.number);
+      }
+    }
+    BeginObject(Page_tree_object);
+    _out += "<<\n/Type /Pages\n/Kids [ ";
+    for (std::uint32_t kid : kids) {
+      AppendReference(_out, kid);
+      _out += ' ';
+    }
+    _out += "]\n/Count ";
+    AppendInteger(_out, _pages.size());
+    _out += "\n>>";
+    EndObject();
+    BeginObject(Catalog_object);
+    _out += "<<\n/Type /Catalog\n/Pages ";
+    AppendReference(_out, Page_tree_object);
+    _out += "\n>>";
+    EndObject();
+
+    size_t xref_offset = GetSize();
+    _out += "xref\n0 ";
+    AppendInteger(_out, _offsets.size());
+    _out += "\n0000000000 65535 f\r\n";
+    char entry[21];
+    for (size_t number = 1; number < _offsets.size(); number++) {
+      /* Every entry is exactly 20 bytes: a 10 digit offset, 00000 n, EOL */
+      size_t offset = _offsets[number];
+      for (int index = 9; index >= 0; index--) {
+        entry[index] = '0' + offset % 10;
+        offset /= 10;
+      }
+      memcpy(entry + 10, " 00000 n\r\n", 10);
+      _out.append(entry, 20);
+    }
+    _out += "trailer\n<<\n/Root ";
+    AppendReference(_out, Catalog_object);
+    _out += "\n/Info ";
+    AppendReference(_out, Info_object);
+    _out += "\n/Size ";
+    AppendInteger(_out, _offsets.size());
+    _out += "\n>>\nstartxref\n";
+    AppendInteger(_out, xref_offset);
+    _out += "\n%%EOF\n";
+    _is_finished = true;
+    Drain(true);
+    return _out;
+  }
+};
+#endif // PLANNER_PDF_WRITER_HPP
@@ -0,0 +1,301 @@
+#ifndef PLANNER_SERVER_HPP
+#define PLANNER_SERVER_HPP
+// The MIT License (MIT)
+//
+// Copyright (c) 2015, 2016, 2017 Howard Hinnant
+// Copyright (c) 2016 Adrian Colomitchi
+// Copyright (c) 2017 Florian Dang
+// Copyright (c) 2017 Paul Thompson
+// Copyright (c) 2018, 2019 Tomasz Kamiński
+// Copyright (c) 2019 Jiangang Zhuang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Our apologies.  When the previous paragraph was written, lowercase had not
+// yet been invented (that would involve another several millennia of
+// evolution). We did not mean to shout.
+#include "utils.hpp"
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <list>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <utility>
+
+/*!
+ * @brief
+ * Long running server generating planners for requests on a Unix socket.
+ *
+ * A client connects, sends the options of one planner as a JSON object on a
+ * single line and receives either "OK <size>\n" followed by the PDF of
+ * <size> bytes, or "ERR <message>\n". The calendar strings, the page
+ * templates and the grid layouts stay recorded between requests, and the
+ * last generated planners are kept to answer repeated requests straight
+ * away. Connections are served one after the other, so a client which does
+ * not send its request or does not read the reply in time is dropped
+ * instead of holding up the others.
+ */
+class PlannerServer {
+  std::string _socket_path;
+  /*! The options every request starts from */
+  PlannerOptions _base_options;
+  /*! Generates the PDF of a planner into memory */
+  std::function<void(const PlannerOptions&, std::string&)> _generate;
+  /*! The generated planners by their options, most recently used first */
+  std::list<std::pair<std::string, std::string>> _documents;
+  size_t _max_documents;
+
+  /*! The time a client has to send its request */
+  static constexpr int Receive_timeout_ms = 5000;
+  /*! The time a client has to read the reply */
+  static constexpr int Send_timeout_ms = 30000;
+
+  using Deadline = std::chrono::steady_clock::time_point;
+
+  static Deadline GetDeadline(int timeout_ms) {
+    return std::chrono::steady_clock::now() +
+           std::chrono::milliseconds(timeout_ms);
+  }
+
+  /*!
+   * Wait until the connection is ready for events, returns false if the
+   * deadline passed first or the connection failed
+   */
+  static bool WaitFor(int connection, short events, Deadline deadline) {
+    while (true) {
+      auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                           deadline - std::chrono::steady_clock::now())
+                           .count();
+      if (remaining <= 0) {
+        return false;
+      }
+      struct pollfd poll_fd = {connection, events, 0};
+      int ready = poll(&poll_fd, 1, (int)remaining);
+      if (ready < 0 && errno == EINTR) {
+        continue;
+      }
+      return ready > 0;
+    }
+  }
+
+  /*! The options that change the generated document, as a lookup key */
+  static std::string GetDocumentKey(const PlannerOptions& options) {
+    return std::to_string(options.start_year) + " " +
+           std::to_string(options.num_years) + " " +
+           std::to_string(options.time_gap_lines) + " " +
+           std::to_string(options.time_start) + " " +
+           std::to_string(options.compression_mode) + " " +
+           std::to_string(options.start_day) + " " +
+           std::to_string(options.is_left_handed) + " " +
+           std::to_string(options.is_portrait) + " " +
+           std::to_string(options.time_in_margin) + " " +
+           std::to_string(options.object_streams) + " " +
+           std::to_string(options.native_writer) + " " +
+           std::to_string(options.precision) + " " +
+           std::to_string(options.pages_per_node);
+  }
+
+  /*!
+   * Whether a request kept the paths of the server options. Requests only
+   * get their planner back on the socket, whatever the server writes to
+   * disk, such as the page cache, stays under the paths given on its own
+   * command line.
+   */
+  bool HasServerPaths(const PlannerOptions& options) {
+    return options.filename == _base_options.filename &&
+           options.cache_dir == _base_options.cache_dir &&
+           options.extend_file == _base_options.extend_file &&
+           options.batch_file == _base_options.batch_file &&
+           options.serve_socket == _base_options.serve_socket;
+  }
+
+  static bool
+  SendAll(int connection, const char* data, size_t size, Deadline deadline) {
+    while (size > 0) {
+      if (false == WaitFor(connection, POLLOUT, deadline)) {
+        return false;
+      }
+      ssize_t sent =
+          send(connection, data, size, MSG_NOSIGNAL | MSG_DONTWAIT);
+      if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK ||
+                       errno == EINTR)) {
+        continue;
+      }
+      if (sent <= 0) {
+        return false;
+      }
+      data += sent;
+      size -= sent;
+    }
+    return true;
+  }
+
+  static void SendError(int connection, const std::string& message) {
+    std::string reply = "ERR " + message + "\n";
+    SendAll(connection,
+            reply.data(),
+            reply.size(),
+            GetDeadline(Send_timeout_ms));
+  }
+
+  /*! Find the document of key, moving it to the front, or generate it */
+  const std::string* GetDocument(const std::string& key,
+                                 const PlannerOptions& options) {
+    for (auto document_it = _documents.begin();
+         document_it != _documents.end();
+         document_it++) {
+      if (document_it->first == key) {
+        _documents.splice(_documents.begin(), _documents, document_it);
+        return &_documents.front().second;
+      }
+    }
+
+    std::string pdf;
+    try {
+      _generate(options, pdf);
+    } catch (std::exception&) {
+      return NULL;
+    }
+    if (0 == _max_documents) {
+      _documents.clear();
+    } else if (_documents.size() >= _max_documents) {
+      _documents.pop_back();
+    }
+    _documents.emplace_front(key, std::move(pdf));
+    return &_documents.front().second;
+  }
+
+  void HandleConnection(int connection) {
+    std::string request;
+    char buffer[4096];
+    Deadline receive_deadline = GetDeadline(Receive_timeout_ms);
+    while (request.find('\n') == std::string::npos &&
+           request.size() < 65536) {
+      if (false == WaitFor(connection, POLLIN, receive_deadline)) {
+        std::cout << "[ERR] : Dropping a client which did not send its "
+                     "request in time"
+                  << std::endl;
+        return;
+      }
+      ssize_t received =
+          recv(connection, buffer, sizeof(buffer), MSG_DONTWAIT);
+      if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK ||
+                           errno == EINTR)) {
+        continue;
+      }
+      if (received <= 0) {
+        break;
+      }
+      request.append(buffer, received);
+    }
+    request = request.substr(0, request.find('\n'));
+
+    PlannerOptions options = _base_options;
+    if (false == ParsePlannerOptionsJson(request, options)) {
+      SendError(connection, "invalid request");
+      return;
+    }
+    if (false == HasServerPaths(options)) {
+      SendError(connection, "paths cannot be set by a request");
+      return;
+    }
+
+    const std::string* pdf = GetDocument(GetDocumentKey(options), options);
+    if (NULL == pdf) {
+      SendError(connection, "failed to generate planner");
+      return;
+    }
+    std::string header = "OK " + std::to_string(pdf->size()) + "\n";
+    Deadline send_deadline = GetDeadline(Send_timeout_ms);
+    if (false == SendAll(connection,
+                         header.data(),
+                         header.size(),
+                         send_deadline) ||
+        false == SendAll(connection, pdf->data(), pdf->size(), send_deadline)) {
+      std::cout << "[ERR] : Failed to send the planner to a client"
+                << std::endl;
+    }
+    /* Without room for documents, the one just sent is not kept */
+    if (0 == _max_documents) {
+      _documents.clear();
+    }
+  }
+
+public:
+  PlannerServer(
+      const std::string& socket_path,
+      const PlannerOptions& base_options,
+      size_t max_documents,
+      const std::function<void(const PlannerOptions&, std::string&)>& generate)
+      : _socket_path(socket_path), _base_options(base_options),
+        _generate(generate), _max_documents(max_documents) {}
+
+  /*!
+   * Serve requests one after the other until the socket fails, returns the
+   * exit code of the process
+   */
+  int Run() {
+    struct sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (_socket_path.size() >= sizeof(address.sun_path)) {
+      std::cout << "[ERR] : Socket path is too long : " << _socket_path
+                << std::endl;
+      return 1;
+    }
+    _socket_path.copy(address.sun_path, _socket_path.size());
+
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(_socket_path.c_str());
+    if (server < 0 ||
+        bind(server, (struct sockaddr*)&address, sizeof(address)) < 0 ||
+        listen(server, 16) < 0) {
+      std::cout << "[ERR] : Unable to listen on socket : " << _socket_path
+                << std::endl;
+      if (server >= 0) {
+        close(server);
+      }
+      return 1;
+    }
+    std::cout << "[INFO] : Serving planners on " << _socket_path << std::endl;
+
+    while (true) {
+      int connection = accept(server, NULL, NULL);
+      if (connection < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        std::cout << "[ERR] : Failed to accept connection on socket : "
+                  << _socket_path << std::endl;
+        break;
+      }
+      HandleConnection(connection);
+      close(connection);
+    }
+    close(server);
+    unlink(_socket_path.c_str());
+    return 1;
+  }
+};
+#endif // PLANNER_SERVER_HPP
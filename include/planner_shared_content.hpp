@@ -0,0 +1,141 @@
+#ifndef PLANNER_SHARED_CONTENT_HPP
+#define PLANNER_SHARED_CONTENT_HPP
+// The MIT License (MIT)
+//
+// Copyright (c) 2015, 2016, 2017 Howard Hinnant
+// Copyright (c) 2016 Adrian Colomitchi
+// Copyright (c) 2017 Florian Dang
+// Copyright (c) 2017 Paul Thompson
+// Copyright (c) 2018, 2019 Tomasz Kamiński
+// Copyright (c) 2019 Jiangang Zhuang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Our apologies.  When the previous paragraph was written, lowercase had not
+// yet been invented (that would involve another several millennia of
+// evolution). We did not mean to shout.
+#include "hpdf.h"
+#include <functional>
+#include <map>
+#include <string>
+
+/*!
+ * @brief
+ * Registry of content streams that are drawn once per document and then
+ * referenced by every page that shows the same static content, and of the
+ * link destinations shared by every link to the same page.
+ */
+class PlannerSharedContent {
+  /*!
+   * The shared content streams of every open document, keyed by the name the
+   * caller gave to the content
+   */
+  static std::map<HPDF_Doc, std::map<std::string, HPDF_Dict>>& Registry() {
+    static std::map<HPDF_Doc, std::map<std::string, HPDF_Dict>> registry;
+    return registry;
+  }
+
+  /*!
+   * The number of decimals coordinates are written with, per open document
+   * that does not use the default
+   */
+  static std::map<HPDF_Doc, int>& Precisions() {
+    static std::map<HPDF_Doc, int> precisions;
+    return precisions;
+  }
+
+  /*! The destination of every page linked to so far, per open document */
+  static std::map<HPDF_Doc, std::map<HPDF_Page, HPDF_Destination>>&
+  Destinations() {
+    static std::map<HPDF_Doc, std::map<HPDF_Page, HPDF_Destination>>
+        destinations;
+    return destinations;
+  }
+
+public:
+  /*!
+   * Add the content registered under key to the page. The first page asking
+   * for a key records draw_function into a content stream of its own, every
+   * later page only references that stream. The content is wrapped in a
+   * save/restore pair so it does not leak graphics state into the page.
+   */
+  static void Stamp(HPDF_Doc doc,
+                    HPDF_Page page,
+                    const std::string& key,
+                    const std::function<void(HPDF_Page&)>& draw_function) {
+    std::map<std::string, HPDF_Dict>& streams = Registry()[doc];
+    auto stream_it = streams.find(key);
+    if (stream_it != streams.end()) {
+      HPDF_Page_Insert_Shared_Content_Stream(page, stream_it->second);
+      return;
+    }
+
+    HPDF_Dict stream;
+    HPDF_Page_New_Content_Stream(page, &stream);
+    HPDF_Page_GSave(page);
+    draw_function(page);
+    HPDF_Page_GRestore(page);
+    /* Continue the rest of the page in a stream of its own */
+    HPDF_Page_New_Content_Stream(page, NULL);
+    streams[key] = stream;
+  }
+
+  /*!
+   * Get the destination showing the whole of page. libharu adds every
+   * destination to the document as an object of its own, so the first link
+   * to a page creates it and every later link refers to the same one.
+   */
+  static HPDF_Destination GetDestination(HPDF_Doc doc, HPDF_Page page) {
+    std::map<HPDF_Page, HPDF_Destination>& destinations = Destinations()[doc];
+    auto destination_it = destinations.find(page);
+    if (destination_it != destinations.end()) {
+      return destination_it->second;
+    }
+
+    HPDF_Destination destination = HPDF_Page_CreateDestination(page);
+    destinations[page] = destination;
+    return destination;
+  }
+
+  /*!
+   * Set the number of decimals the coordinates of the pages of doc are
+   * rounded to when they are written
+   */
+  static void SetPrecision(HPDF_Doc doc, int decimals) {
+    Precisions()[doc] = decimals;
+  }
+
+  /*! The number of decimals coordinates are rounded to, or default_decimals */
+  static int GetPrecision(HPDF_Doc doc, int default_decimals) {
+    auto precision_it = Precisions().find(doc);
+    return (precision_it != Precisions().end()) ? precision_it->second
+                                                : default_decimals;
+  }
+
+  /*!
+   * Drop the streams, destinations and settings recorded for a document,
+   * must be called before the document is freed
+   */
+  static void Release(HPDF_Doc doc) {
+    Registry().erase(doc);
+    Destinations().erase(doc);
+    Precisions().erase(doc);
+  }
+};
+#endif // PLANNER_SHARED_CONTENT_HPP
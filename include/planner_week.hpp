@@ -69,7 +69,9 @@ public:
 
   void Build(HPDF_Doc& doc) {
     CreatePage(doc, _page_height, _page_width);
+    DrawPageTemplate(_display_list, true);
     CreateNotesSection(false);
+    FlushDisplayList(doc);
   }
 };
 #endif // PLANNER_WEEK_HPP
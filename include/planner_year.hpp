@@ -38,7 +38,10 @@
  */
 class PlannerYear : public PlannerBase {
   date::year _year;
-  std::vector<std::shared_ptr<PlannerBase>> _months;
+  /*! The month and day pages of this year, stored contiguously */
+  std::vector<PlannerMonth> _month_pages;
+  std::vector<PlannerDay> _day_pages;
+  std::vector<PlannerBase*> _months;
   short _first_day_of_week;
 
 public:
@@ -51,7 +54,7 @@ public:
   }
 
   PlannerYear(date::year year,
-              std::shared_ptr<PlannerBase> parent_main,
+              PlannerBase* parent_main,
               HPDF_REAL height,
               HPDF_REAL width,
               HPDF_REAL margin,
@@ -62,8 +65,8 @@ public:
               int time_gap_lines,
               int time_start)
       : _year(year) {
-    _page_title = format("%Y", _year);
-    _grid_string = format("%Y", _year);
+    _page_title = PlannerCalendarStrings::YearTitle(_year);
+    _grid_string = PlannerCalendarStrings::YearTitle(_year);
     _page_height = height;
     _page_width = width;
     _note_section_percentage = is_portrait ? 0.085 : 0.25;
@@ -104,7 +107,7 @@ public:
     }
 
     CreateGrid(doc,
-               _page,
+               _display_list,
                section_x_start + 15,
                section_y_start + 5,
                section_x_stop - 15,
@@ -123,54 +126,141 @@ public:
   }
 
   void BuildMonths(HPDF_Doc& doc) {
-    for (auto month : _months) {
-      std::static_pointer_cast<PlannerMonth>(month)->Build(doc);
+    for (auto& month : _month_pages) {
+      month.Build(doc);
+      month.BuildDays(doc);
+    }
+  }
+
+  /*!
+   * Create the pages of the year, its months and their days in the order
+   * Build and BuildMonths create them, without recording anything
+   */
+  void CreatePages(HPDF_Doc& doc) {
+    CreatePage(doc, _page_height, _page_width);
+    for (auto& month : _month_pages) {
+      month.CreatePages(doc);
+    }
+  }
+
+  void RecordMonths(HPDF_Doc& doc) {
+    for (auto& month : _month_pages) {
+      month.Record(doc);
+      month.RecordDays(doc);
     }
   }
 
-  std::vector<std::shared_ptr<PlannerBase>>& GetMonths() { return _months; }
+  std::vector<PlannerBase*>& GetMonths() { return _months; }
+
+  std::vector<PlannerMonth>& GetMonthPages() { return _month_pages; }
+
+  std::vector<PlannerDay>& GetDayPages() { return _day_pages; }
 
   void CreateNavigation(HPDF_Doc& doc) {
-    AddNavigation();
-    for (auto month : _months) {
-      std::static_pointer_cast<PlannerMonth>(month)->CreateNavigation(doc);
+    if (false == _is_cached && false == _is_placeholder) {
+      AddNavigation();
+    }
+    for (auto& month : _month_pages) {
+      month.CreateNavigation(doc);
     }
   }
 
-  void Build(HPDF_Doc& doc) {
-    CreatePage(doc, _page_height, _page_width);
-    /* Add months to _months and call build on each of them */
+  void FlushDisplayLists(HPDF_Doc& doc, DisplayListStats* stats = NULL) {
+    FlushDisplayList(doc, stats);
+    for (auto& month : _month_pages) {
+      month.FlushDisplayLists(doc, stats);
+    }
+  }
+
+  /*!
+   * Release the months and days of this year once all their pages and the
+   * pages linking to them have been written to the document
+   */
+  void ReleaseMonths() {
+    std::vector<PlannerBase*>().swap(_months);
+    std::vector<PlannerDay>().swap(_day_pages);
+    std::vector<PlannerMonth>().swap(_month_pages);
+  }
+
+  /*!
+   * Function to add the months and their days to this year. This does not
+   * touch the PDF document, so years can be added in parallel. The links
+   * to the previous year are made afterwards by LinkToPreviousYear.
+   */
+  void AddMonths() {
+    /* The pages link to each other, so they must never be reallocated */
+    _month_pages.reserve(12);
+    _day_pages.reserve(366);
     for (size_t month_id = 1; month_id <= 12; month_id++) {
-      _months.push_back(std::make_shared<PlannerMonth>(
-          PlannerMonth((date::year_month){_year, (date::month)month_id},
-                       shared_from_this(),
-                       _page_height,
-                       _page_width,
-                       _margin_width,
-                       _first_day_of_week,
-                       _is_left_handed,
-                       _is_portrait,
-                       _time_in_margin,
-                       _time_gap_lines,
-                       _time_start)));
-
-      std::shared_ptr<PlannerBase> prev_month;
+      _month_pages.emplace_back((date::year_month){_year, (date::month)month_id},
+                                this,
+                                _page_height,
+                                _page_width,
+                                _margin_width,
+                                _first_day_of_week,
+                                _is_left_handed,
+                                _is_portrait,
+                                _time_in_margin,
+                                _time_gap_lines,
+                                _time_start);
+      _month_pages.back().SetPageCache(_page_cache);
+      _month_pages.back().SetPdfWriter(_pdf_writer);
+      _months.push_back(&_month_pages.back());
 
       if (month_id > 1) {
-        prev_month = _months[month_id - 2];
-      } else {
-        if (NULL != _left) {
-          prev_month =
-              std::static_pointer_cast<PlannerYear>(_left)->GetMonths().back();
-        }
-      }
-
-      if (NULL != prev_month) {
+        PlannerBase* prev_month = _months[month_id - 2];
         _months.back()->SetLeft(prev_month);
         prev_month->SetRight(_months.back());
       }
     }
-    BuildMonths(doc);
+
+    for (auto& month : _month_pages) {
+      month.AddDays(_day_pages);
+    }
+  }
+
+  /*!
+   * Function to link the first month and day of this year to the last month
+   * and day of the previous year
+   */
+  void LinkToPreviousYear() {
+    if (NULL == _left) {
+      return;
+    }
+
+    PlannerBase* prev_month = static_cast<PlannerYear*>(_left)->GetMonths().back();
+    _months.front()->SetLeft(prev_month);
+    prev_month->SetRight(_months.front());
+
+    PlannerBase* prev_day =
+        static_cast<PlannerMonth*>(prev_month)->GetDays().back();
+    PlannerBase* first_day = _month_pages.front().GetDays().front();
+    first_day->SetLeft(prev_day);
+    prev_day->SetRight(first_day);
+  }
+
+  void Build(HPDF_Doc& doc) {
+    CreatePage(doc, _page_height, _page_width);
+    Record(doc);
+  }
+
+  /*!
+   * Record the operations of the page without touching the PDF document,
+   * the page itself is created by CreatePage
+   */
+  void Record(HPDF_Doc& doc) {
+    /* The thumbnails of the months link to their days as well */
+    std::vector<PlannerBase*> children = _months;
+    for (auto& day : _day_pages) {
+      children.push_back(&day);
+    }
+    if (true == _is_placeholder ||
+        true == LoadFromPageCache(PlannerTypes_Year,
+                                      std::to_string(_first_day_of_week),
+                                      children)) {
+      return;
+    }
+    StampPageTemplate(PlannerTypes_Year, false == _is_portrait);
     AddMonthsSection(doc);
     CreateTitle();
     if (false == _is_portrait) {
@@ -34,6 +34,10 @@
 #include "hpdf.h"
 #include <iostream>
 #include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 enum PlannerTypes {
   PlannerTypes_Base,
@@ -49,12 +53,102 @@ const std::int64_t Remarkable_height_px = 1404;
 // const std::int64_t Remarkable_width_px = 1404;
 // const std::int64_t Remarkable_height_px = 1872;
 const std::int64_t Remarkable_margin_width_px = 120;
-HPDF_REAL GetCenteredTextYPosition(HPDF_Page& page,
-                                   std::string text,
+
+/*! The stream compression modes that can be selected for the document */
+const std::pair<const char*, HPDF_UINT> Compression_modes[] = {
+    {"none", HPDF_COMP_NONE},
+    {"text", HPDF_COMP_TEXT},
+    {"image", HPDF_COMP_IMAGE},
+    {"metadata", HPDF_COMP_METADATA},
+    {"all", HPDF_COMP_ALL},
+};
+
+/*!
+ * @brief
+ * The options describing one planner file to generate
+ */
+struct PlannerOptions {
+  short start_year = 2021;
+  short num_years = 5;
+  std::string filename = "planner.pdf";
+  int time_gap_lines = 4;
+  int time_start = 700;
+  HPDF_UINT compression_mode = HPDF_COMP_ALL;
+  short start_day = 0;
+  bool is_left_handed = false;
+  bool is_portrait = false;
+  bool time_in_margin = false;
+  /*! Number of threads used to set up the years of the planner */
+  unsigned num_jobs = 1;
+  /*! Manifest listing several planners to generate in one run */
+  std::string batch_file;
+  /*! Print timings and counters of each generated planner on stderr */
+  bool stats = false;
+  /*!
+   * Pages under each intermediate node of the page tree, 0 for a flat tree
+   * and -1 to balance it
+   */
+  int pages_per_node = -1;
+  /*! Pack the objects of the document into object streams */
+  bool object_streams = false;
+  /*! Write the document with PlannerPdfWriter instead of libharu */
+  bool native_writer = false;
+  /*! Decimals of the coordinates written to the pages, 5 keeps them all */
+  int precision = 5;
+  /*!
+   * Existing planner, one year shorter, the last year is added to as an
+   * incremental update
+   */
+  std::string extend_file;
+  /*! Directory of the page cache, the cache is disabled if empty */
+  std::string cache_dir;
+  /*! Unix socket to serve planners on instead of generating one */
+  std::string serve_socket;
+  /*! Number of generated planners the server keeps to answer repeats */
+  size_t serve_cache_size = 8;
+};
+
+/*!
+ * Parse command line style arguments on top of the given options, returns
+ * false if an argument is invalid
+ */
+bool ParsePlannerOptions(const std::vector<std::string>& args,
+                         PlannerOptions& options);
+
+/*!
+ * Parse the options of a planner given as a flat JSON object on top of the
+ * given options, returns false if the object or one of its members is
+ * invalid. The members are named like the command line options, "year" and
+ * "years" give the start year and the number of years, for example
+ * {"year": 2024, "years": 1, "start-day": 1, "left-handed": true}
+ */
+bool ParsePlannerOptionsJson(const std::string& json, PlannerOptions& options);
+
+/*!
+ * Look up a compression mode by its name, returns false if the name is not
+ * one of Compression_modes
+ */
+bool GetCompressionMode(const std::string& name, HPDF_UINT& mode);
+
+/*! Get the name of a compression mode for reporting */
+std::string GetCompressionModeName(HPDF_UINT mode);
+
+/*! Escape a string for use inside a quoted JSON string */
+std::string JsonEscape(const std::string& text);
+
+/*!
+ * Get the width of text set in Helvetica, the only font of the planner, at
+ * the given size. The width comes from the font metrics alone, no PDF page or
+ * font object is needed.
+ */
+HPDF_REAL GetTextWidth(HPDF_REAL font_size, std::string_view text);
+
+HPDF_REAL GetCenteredTextYPosition(HPDF_REAL font_size,
+                                   std::string_view text,
                                    HPDF_REAL y_start,
                                    HPDF_REAL y_end);
-HPDF_REAL GetCenteredTextXPosition(HPDF_Page& page,
-                                   std::string text,
+HPDF_REAL GetCenteredTextXPosition(HPDF_REAL font_size,
+                                   std::string_view text,
                                    HPDF_REAL x_start,
                                    HPDF_REAL x_end);
 /**
@@ -66,14 +160,15 @@ HPDF_REAL GetCenteredTextXPosition(HPDF_Page& page,
  *
  */
 class PlannerBase;
+class PlannerDisplayList;
 void CreateThumbnailCaller(HPDF_Doc& doc,
-                           HPDF_Page& page,
+                           PlannerDisplayList& display_list,
                            HPDF_REAL x_start,
                            HPDF_REAL y_start,
                            HPDF_REAL x_stop,
                            HPDF_REAL y_stop,
                            PlannerTypes type,
                            PlannerTypes object_type,
-                           std::shared_ptr<PlannerBase> object);
+                           PlannerBase* object);
 
 #endif // UTILS_HPP
@@ -0,0 +1,459 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015, 2016, 2017 Howard Hinnant
+// Copyright (c) 2016 Adrian Colomitchi
+// Copyright (c) 2017 Florian Dang
+// Copyright (c) 2017 Paul Thompson
+// Copyright (c) 2018, 2019 Tomasz Kamiński
+// Copyright (c) 2019 Jiangang Zhuang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Our apologies.  When the previous paragraph was written, lowercase had not
+// yet been invented (that would involve another several millennia of
+// evolution). We did not mean to shout.
+
+
+#include "planner_main.hpp"
+#include "planner_pdf_config.h"
+#include "utils.hpp"
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <sys/resource.h>
+#include <vector>
+
+/*!
+ * @brief
+ * Timing and size of one page type, measured on a single year
+ */
+struct PageTypeResult {
+  std::string name;
+  size_t pages;
+  double ns_per_page;
+  double bytes_per_page;
+};
+
+/*!
+ * @brief
+ * Timing, size and memory of a complete planner
+ */
+struct PlannerResult {
+  size_t num_years;
+  size_t pages;
+  double build_ns;
+  double save_ns;
+  HPDF_UINT32 bytes;
+  long peak_rss_kb;
+};
+
+template <typename Function> double TimeNs(Function function) {
+  auto start = std::chrono::steady_clock::now();
+  function();
+  return std::chrono::duration<double, std::nano>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+/*! The high water mark of the resident set size of this process */
+long PeakRssKb() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+/*! Serialize the document into memory and return its size in bytes */
+HPDF_UINT32 SavedSize(HPDF_Doc doc) {
+  HPDF_SaveToStream(doc);
+  return HPDF_GetStreamSize(doc);
+}
+
+HPDF_Doc CreateBenchDocument(const PlannerOptions& options) {
+  HPDF_Doc doc = HPDF_New(PlannerMain::err_cb, NULL);
+  PlannerSharedContent::Release(doc);
+  PlannerSharedContent::SetPrecision(doc, options.precision);
+  HPDF_SetCompressionMode(doc, options.compression_mode);
+  return doc;
+}
+
+void FreeBenchDocument(HPDF_Doc doc) {
+  PlannerSharedContent::Release(doc);
+  HPDF_Free(doc);
+}
+
+/*!
+ * Build every page of one year, as links need their target pages to exist,
+ * but only navigate and write the pages of page_type. The time spent on those
+ * pages is returned in build_ns and the size of the resulting document in
+ * bytes. With PlannerTypes_Base no page is written at all, which gives the
+ * size of the empty pages to subtract.
+ */
+size_t BuildYearPages(const PlannerOptions& options,
+                      PlannerTypes page_type,
+                      double& build_ns,
+                      HPDF_UINT32& bytes) {
+  HPDF_Doc doc = NULL;
+  std::unique_ptr<PlannerPdfWriter> pdf_writer;
+  if (true == options.native_writer) {
+    pdf_writer = std::make_unique<PlannerPdfWriter>(
+        options.compression_mode, 0, 1 + 12 + 366);
+    pdf_writer->SetPrecision(options.precision);
+  } else {
+    doc = CreateBenchDocument(options);
+  }
+  PlannerYear year((date::year)options.start_year,
+                   NULL,
+                   options.is_portrait ? Remarkable_width_px
+                                       : Remarkable_height_px,
+                   options.is_portrait ? Remarkable_height_px
+                                       : Remarkable_width_px,
+                   Remarkable_margin_width_px,
+                   options.start_day,
+                   options.is_left_handed,
+                   options.is_portrait,
+                   options.time_in_margin,
+                   options.time_gap_lines,
+                   options.time_start);
+  year.SetPdfWriter(pdf_writer.get());
+  year.AddMonths();
+
+  std::vector<PlannerBase*> pages;
+  build_ns = 0;
+
+  double ns = TimeNs([&]() { year.Build(doc); });
+  if (PlannerTypes_Year == page_type) {
+    build_ns += ns;
+    pages.push_back(&year);
+  }
+  for (auto& month : year.GetMonthPages()) {
+    ns = TimeNs([&]() { month.Build(doc); });
+    if (PlannerTypes_Month == page_type) {
+      build_ns += ns;
+      pages.push_back(&month);
+    }
+    for (auto day : month.GetDays()) {
+      ns = TimeNs([&]() { static_cast<PlannerDay*>(day)->Build(doc); });
+      if (PlannerTypes_Day == page_type) {
+        build_ns += ns;
+        pages.push_back(day);
+      }
+    }
+  }
+
+  build_ns += TimeNs([&]() {
+    for (auto page : pages) {
+      page->AddNavigation();
+      page->FlushDisplayList(doc);
+    }
+  });
+
+  if (NULL != pdf_writer) {
+    bytes = pdf_writer->Finish().size();
+  } else {
+    bytes = SavedSize(doc);
+    FreeBenchDocument(doc);
+  }
+  return pages.size();
+}
+
+std::vector<PageTypeResult> BenchPageTypes(const PlannerOptions& options) {
+  const std::pair<const char*, PlannerTypes> page_types[] = {
+      {"year", PlannerTypes_Year},
+      {"month", PlannerTypes_Month},
+      {"day", PlannerTypes_Day},
+  };
+  std::vector<PageTypeResult> results;
+  double build_ns;
+  HPDF_UINT32 empty_bytes;
+  BuildYearPages(options, PlannerTypes_Base, build_ns, empty_bytes);
+
+  for (auto& page_type : page_types) {
+    HPDF_UINT32 bytes;
+    size_t pages =
+        BuildYearPages(options, page_type.second, build_ns, bytes);
+    results.push_back({page_type.first,
+                       pages,
+                       build_ns / pages,
+                       ((double)bytes - empty_bytes) / pages});
+  }
+  return results;
+}
+
+/*!
+ * Time recording the days grid of a month with CreateGrid. Month pages only
+ * pay for this once per shape of month, see BenchGridStamp.
+ */
+double BenchGrid(const PlannerOptions& options,
+                 size_t num_calls,
+                 size_t& ops_per_call) {
+  HPDF_Doc doc = CreateBenchDocument(options);
+  PlannerYear year((date::year)options.start_year,
+                   NULL,
+                   Remarkable_height_px,
+                   Remarkable_width_px,
+                   Remarkable_margin_width_px,
+                   options.start_day,
+                   options.is_left_handed,
+                   options.is_portrait,
+                   options.time_in_margin,
+                   options.time_gap_lines,
+                   options.time_start);
+  year.AddMonths();
+  PlannerMonth& month = year.GetMonthPages().front();
+  PlannerDisplayList display_list;
+
+  double ns = TimeNs([&]() {
+    for (size_t call = 0; call < num_calls; call++) {
+      display_list.Clear();
+      month.CreateGrid(doc,
+                       display_list,
+                       0,
+                       0,
+                       Remarkable_width_px,
+                       Remarkable_height_px,
+                       6,
+                       7,
+                       month.GetDays(),
+                       true,
+                       0,
+                       false,
+                       PlannerTypes_Month,
+                       PlannerTypes_Day,
+                       Remarkable_height_px,
+                       10,
+                       true);
+    }
+  });
+  ops_per_call = display_list.GetOps().size();
+  FreeBenchDocument(doc);
+  return ns / num_calls;
+}
+
+/*!
+ * Time adding the days grid of a month the way month pages do, stamping the
+ * grid shared by the months of the same shape and linking it to the days.
+ * The months of the year are taken in turn.
+ */
+double BenchGridStamp(const PlannerOptions& options,
+                      size_t num_calls,
+                      size_t& ops_per_call) {
+  HPDF_Doc doc = CreateBenchDocument(options);
+  PlannerYear year((date::year)options.start_year,
+                   NULL,
+                   Remarkable_height_px,
+                   Remarkable_width_px,
+                   Remarkable_margin_width_px,
+                   options.start_day,
+                   options.is_left_handed,
+                   options.is_portrait,
+                   options.time_in_margin,
+                   options.time_gap_lines,
+                   options.time_start);
+  year.AddMonths();
+  auto& months = year.GetMonthPages();
+  PlannerDisplayList display_list;
+
+  double ns = TimeNs([&]() {
+    for (size_t call = 0; call < num_calls; call++) {
+      display_list.Clear();
+      months[call % months.size()].AddDaysSection(doc,
+                                                  display_list,
+                                                  0,
+                                                  0,
+                                                  Remarkable_width_px,
+                                                  Remarkable_height_px,
+                                                  false,
+                                                  10);
+    }
+  });
+  ops_per_call = display_list.GetOps().size();
+  FreeBenchDocument(doc);
+  return ns / num_calls;
+}
+
+PlannerResult BenchPlanner(const PlannerOptions& options, size_t num_years) {
+  PlannerResult result = {};
+  auto planner = std::make_shared<PlannerMain>(
+      options.start_year,
+      options.filename,
+      num_years,
+      options.is_portrait ? Remarkable_width_px : Remarkable_height_px,
+      options.is_portrait ? Remarkable_height_px : Remarkable_width_px,
+      Remarkable_margin_width_px,
+      options.start_day,
+      options.is_left_handed,
+      options.is_portrait,
+      options.time_in_margin,
+      options.time_gap_lines,
+      options.time_start,
+      options.compression_mode);
+  planner->SetNumJobs(options.num_jobs);
+  planner->SetNativeWriter(options.native_writer);
+  planner->SetPrecision(options.precision);
+
+  result.num_years = num_years;
+  result.build_ns = TimeNs([&]() {
+    planner->CreateDocument();
+    planner->Build();
+  });
+  std::string pdf;
+  result.save_ns = TimeNs([&]() { planner->SaveToMemory(pdf); });
+  result.bytes = pdf.size();
+
+  /* The index page, then a year page, 12 month pages and the days */
+  result.pages = 1;
+  for (size_t year_index = 0; year_index < num_years; year_index++) {
+    date::year year = (date::year)options.start_year + (date::years)year_index;
+    result.pages += 1 + 12 + (year.is_leap() ? 366 : 365);
+  }
+  result.peak_rss_kb = PeakRssKb();
+  return result;
+}
+
+/**!
+ * Benchmark the page types and complete planners, writing the results as
+ * JSON to the file given as first argument. Any --name=value options of the
+ * planner executable apply to the benchmarked planners as well.
+ */
+int main(int argc, char* argv[]) {
+  PlannerOptions options;
+  std::string results_file = "planner_bench.json";
+  std::vector<std::string> args;
+  for (int arg_index = 1; arg_index < argc; arg_index++) {
+    std::string arg = argv[arg_index];
+    if (0 == arg.rfind("--", 0)) {
+      args.push_back(arg);
+    } else {
+      results_file = arg;
+    }
+  }
+  if (false == ParsePlannerOptions(args, options)) {
+    return 1;
+  }
+
+  const size_t grid_calls = 1000;
+  size_t grid_ops = 0;
+  std::vector<PageTypeResult> page_types = BenchPageTypes(options);
+  double grid_ns = BenchGrid(options, grid_calls, grid_ops);
+  size_t grid_stamp_ops = 0;
+  double grid_stamp_ns = BenchGridStamp(options, grid_calls, grid_stamp_ops);
+  std::cout << "[INFO] : Month grid : " << grid_ns << " ns drawn, "
+            << grid_stamp_ns << " ns stamped" << std::endl;
+
+  /* Run the planners in increasing size, so the peak RSS of the process is
+   * the peak of the planner just run */
+  std::vector<PlannerResult> planners;
+  for (size_t num_years : {1, 5, 25, 99}) {
+    planners.push_back(BenchPlanner(options, num_years));
+    const PlannerResult& result = planners.back();
+    std::cout << "[INFO] : " << result.num_years << " years : "
+              << result.pages << " pages, "
+              << (result.build_ns + result.save_ns) / result.pages
+              << " ns/page, " << (double)result.bytes / result.pages
+              << " bytes/page, peak RSS " << result.peak_rss_kb << " kB"
+              << std::endl;
+  }
+
+  /* The same planner written by each writer, the peak RSS is left out as it
+   * is the one of the largest planner above */
+  const size_t writer_years = 5;
+  std::vector<std::pair<std::string, PlannerResult>> writers;
+  for (bool native_writer : {false, true}) {
+    PlannerOptions writer_options = options;
+    writer_options.native_writer = native_writer;
+    writers.emplace_back(native_writer ? "native" : "libharu",
+                         BenchPlanner(writer_options, writer_years));
+    const PlannerResult& result = writers.back().second;
+    std::cout << "[INFO] : " << writers.back().first << " writer, "
+              << result.num_years << " years : "
+              << result.save_ns / 1e6 << " ms saving, "
+              << (result.build_ns + result.save_ns) / result.pages
+              << " ns/page, " << result.bytes << " bytes" << std::endl;
+  }
+
+  std::ofstream results(results_file);
+  if (!results) {
+    std::cout << "[ERR] : Unable to write benchmark results to : "
+              << results_file << std::endl;
+    return 1;
+  }
+  results << "{\n";
+  results << "  \"version\": \"" << Planner_PDF_VERSION_MAJOR << "."
+          << Planner_PDF_VERSION_MINOR << "\",\n";
+  results << "  \"compression\": \""
+          << GetCompressionModeName(options.compression_mode) << "\",\n";
+  results << "  \"jobs\": " << options.num_jobs << ",\n";
+  results << "  \"writer\": \""
+          << (options.native_writer ? "native" : "libharu") << "\",\n";
+  results << "  \"precision\": " << options.precision << ",\n";
+  results << "  \"page_types\": [\n";
+  for (size_t index = 0; index < page_types.size(); index++) {
+    const PageTypeResult& result = page_types[index];
+    results << "    {\"name\": \"" << result.name
+            << "\", \"pages\": " << result.pages
+            << ", \"ns_per_page\": " << result.ns_per_page
+            << ", \"bytes_per_page\": " << result.bytes_per_page << "}"
+            << ((index + 1 < page_types.size()) ? "," : "") << "\n";
+  }
+  results << "  ],\n";
+  results << "  \"grid\": {\"calls\": " << grid_calls
+          << ", \"ns_per_call\": " << grid_ns
+          << ", \"ops_per_call\": " << grid_ops << "},\n";
+  results << "  \"grid_stamp\": {\"calls\": " << grid_calls
+          << ", \"ns_per_call\": " << grid_stamp_ns
+          << ", \"ops_per_call\": " << grid_stamp_ops << "},\n";
+  results << "  \"planners\": [\n";
+  for (size_t index = 0; index < planners.size(); index++) {
+    const PlannerResult& result = planners[index];
+    results << "    {\"years\": " << result.num_years
+            << ", \"pages\": " << result.pages
+            << ", \"build_ns\": " << result.build_ns
+            << ", \"save_ns\": " << result.save_ns
+            << ", \"ns_per_page\": "
+            << (result.build_ns + result.save_ns) / result.pages
+            << ", \"bytes\": " << result.bytes << ", \"bytes_per_page\": "
+            << (double)result.bytes / result.pages
+            << ", \"peak_rss_kb\": " << result.peak_rss_kb << "}"
+            << ((index + 1 < planners.size()) ? "," : "") << "\n";
+  }
+  results << "  ],\n";
+  results << "  \"writers\": [\n";
+  for (size_t index = 0; index < writers.size(); index++) {
+    const PlannerResult& result = writers[index].second;
+    results << "    {\"writer\": \"" << writers[index].first
+            << "\", \"years\": " << result.num_years
+            << ", \"pages\": " << result.pages
+            << ", \"build_ns\": " << result.build_ns
+            << ", \"save_ns\": " << result.save_ns
+            << ", \"ns_per_page\": "
+            << (result.build_ns + result.save_ns) / result.pages
+            << ", \"bytes\": " << result.bytes << ", \"bytes_per_page\": "
+            << (double)result.bytes / result.pages << "}"
+            << ((index + 1 < writers.size()) ? "," : "") << "\n";
+  }
+  results << "  ]\n";
+  results << "}\n";
+
+  std::cout << "[INFO] : Benchmark results written to : " << results_file
+            << std::endl;
+  return 0;
+}
@@ -31,113 +31,171 @@
 
 #include "planner_main.hpp"
 #include "planner_pdf_config.h"
+#include "planner_server.hpp"
 #include "utils.hpp"
+#include <algorithm>
 #include <cstdint>
+#include <fstream>
 #include <iostream>
 #include <memory>
+#include <sstream>
 #include <typeinfo>
 #include <vector>
 
-HPDF_REAL GetCenteredTextYPosition(HPDF_Page& page,
-                                   std::string text,
-                                   HPDF_REAL y_start,
-                                   HPDF_REAL y_end) {
-  HPDF_REAL height = HPDF_Page_GetCurrentFontSize(page);
-  return y_start + ((y_end - y_start) / 2) - height / 2;
+/**!
+ * Create the document of a planner as described by the options and build
+ * all its pages. A streamed planner writes its pages to the file while they
+ * are built.
+ */
+std::shared_ptr<PlannerMain> BuildPlanner(const PlannerOptions& options,
+                                          bool is_streamed = false) {
+  auto planner = std::make_shared<PlannerMain>(
+      options.start_year,
+      options.filename,
+      options.num_years,
+      options.is_portrait ? Remarkable_width_px : Remarkable_height_px,
+      options.is_portrait ? Remarkable_height_px : Remarkable_width_px,
+      Remarkable_margin_width_px,
+      options.start_day,
+      options.is_left_handed,
+      options.is_portrait,
+      options.time_in_margin,
+      options.time_gap_lines,
+      options.time_start,
+      options.compression_mode);
+  planner->SetNumJobs(options.num_jobs);
+  planner->SetObjectStreams(options.object_streams);
+  planner->SetPagesPerNode(options.pages_per_node);
+  planner->SetNativeWriter(options.native_writer);
+  planner->SetPrecision(options.precision);
+  planner->SetPageCacheDirectory(options.cache_dir);
+  planner->SetExtendFile(options.extend_file);
+  planner->SetStreamed(is_streamed);
+  planner->CreateDocument();
+  planner->Build();
+  return planner;
 }
 
-HPDF_REAL GetCenteredTextXPosition(HPDF_Page& page,
-                                   std::string text,
-                                   HPDF_REAL x_start,
-                                   HPDF_REAL x_end) {
-  HPDF_REAL length = HPDF_Page_TextWidth(page, text.c_str());
-  return x_start + ((x_end - x_start) / 2) - length / 2;
-}
+/**!
+ * Sends what is written to std::cout to the standard error while it exists,
+ * so the messages stay out of a document written to the standard output
+ */
+class PlannerMessagesToStderr {
+  std::streambuf* _stdout_buffer;
+
+public:
+  PlannerMessagesToStderr()
+      : _stdout_buffer(std::cout.rdbuf(std::cerr.rdbuf())) {}
+  ~PlannerMessagesToStderr() { std::cout.rdbuf(_stdout_buffer); }
+};
 
-/**
- * @brief
- * A helper function to call the instance specific create thumbnail function
- * This is a little hacky and error prone as it relies on the caller to provide
- * the instance type. This might be helped by transitioning to std::any in the
- * base class to store the child objects instead of shared_ptrs to PlannerBase.
- *
+/**!
+ * Generate a single planner file as described by the options, returns false
+ * if it could not be saved
  */
-void CreateThumbnailCaller(HPDF_Doc& doc,
-                           HPDF_Page& page,
-                           HPDF_REAL x_start,
-                           HPDF_REAL y_start,
-                           HPDF_REAL x_stop,
-                           HPDF_REAL y_stop,
-                           PlannerTypes type,
-                           PlannerTypes object_type,
-                           std::shared_ptr<PlannerBase> object) {
-  switch (object_type) {
-  case PlannerTypes_Month:
-    std::static_pointer_cast<PlannerMonth>(object)->CreateThumbnail(
-        doc, page, x_start, y_start, x_stop, y_stop);
-    break;
-  default:
-    break;
+bool GeneratePlanner(const PlannerOptions& options) {
+  std::unique_ptr<PlannerMessagesToStderr> messages_to_stderr;
+  if (options.filename == "-") {
+    messages_to_stderr = std::make_unique<PlannerMessagesToStderr>();
+  }
+  auto planner = BuildPlanner(options, true);
+  bool is_saved = planner->FinishDocument();
+  if (true == options.stats) {
+    planner->PrintStats(std::cerr);
   }
+  return is_saved;
 }
 
 /**!
- * Main function to generate the file.
+ * Generate every planner listed in a batch manifest. Each line of the
+ * manifest holds the arguments of one planner in the same form as the
+ * command line, on top of the options given on the command line itself.
+ * Empty lines and lines starting with # are skipped.
  */
-int main(int argc, char* argv[]) {
-  short start_year = 2021;
-  short num_years = 5;
-  std::string filename = "planner.pdf";
-  int time_gap_lines = 4;
-  int time_start = 700;
+int GenerateBatch(const PlannerOptions& base_options) {
+  std::ifstream manifest(base_options.batch_file);
+  if (!manifest) {
+    std::cout << "[ERR] : Unable to open batch file : "
+              << base_options.batch_file << std::endl;
+    return 1;
+  }
 
-  if (argc > 1) {
-    int start_year_cl = atoi(argv[1]);
-    if ((start_year_cl != 0) && (start_year_cl < 3000)) {
-      start_year = start_year_cl;
+  int failures = 0;
+  std::string line;
+  size_t line_num = 0;
+  while (std::getline(manifest, line)) {
+    line_num++;
+    std::istringstream line_stream(line);
+    std::vector<std::string> args;
+    std::string arg;
+    while (line_stream >> arg) {
+      args.push_back(arg);
+    }
+    if (args.empty() || args[0][0] == '#') {
+      continue;
     }
-  }
 
-  if (argc > 2) {
-    int num_years_cl = atoi(argv[2]);
-    if ((num_years_cl > 0) && (num_years_cl < 100)) {
-      num_years = num_years_cl;
+    PlannerOptions options = base_options;
+    options.batch_file.clear();
+    if (false == ParsePlannerOptions(args, options) ||
+        false == options.batch_file.empty()) {
+      std::cout << "[ERR] : Skipping invalid line " << line_num
+                << " of batch file : " << base_options.batch_file
+                << std::endl;
+      failures++;
+      continue;
+    }
+
+    try {
+      if (false == GeneratePlanner(options)) {
+        failures++;
+      }
+    } catch (std::exception&) {
+      std::cout << "[ERR] : Failed to generate " << options.filename
+                << " from line " << line_num << " of batch file" << std::endl;
+      failures++;
     }
   }
+  return (failures == 0) ? 0 : 1;
+}
 
-  if (argc > 3) {
-    filename = argv[3];
+/**!
+ * Main function to generate the file.
+ */
+int main(int argc, char* argv[]) {
+  PlannerOptions options;
+  std::vector<std::string> args(argv + 1, argv + argc);
+
+  if (false == ParsePlannerOptions(args, options)) {
+    return 1;
   }
 
-  if (argc > 4) {
-    int time_gap_lines_cl = atoi(argv[4]);
-    if((time_gap_lines_cl > 0) && (time_gap_lines_cl < 10)) {
-      time_gap_lines = time_gap_lines_cl;
-    }
+  if (false == options.batch_file.empty()) {
+    return GenerateBatch(options);
   }
-  if (argc > 5) {
-    int time_start_cl = atoi(argv[5]);
-    if((time_start_cl > 0) && (time_start_cl < 10)) {
-      time_start = time_start_cl;
-    }
+
+  if (false == options.serve_socket.empty()) {
+    PlannerServer server(
+        options.serve_socket,
+        options,
+        options.serve_cache_size,
+        [](const PlannerOptions& request_options, std::string& pdf) {
+          auto planner = BuildPlanner(request_options);
+          planner->SaveToMemory(pdf);
+          std::cout << "[INFO] : Generated planner : " << pdf.size()
+                    << " bytes" << std::endl;
+          if (true == request_options.stats) {
+            planner->PrintStats(std::cerr);
+          }
+        });
+    return server.Run();
   }
 
-  auto Test = std::make_shared<PlannerMain>(PlannerMain(
-      start_year,
-      filename,
-      num_years,
-      Planner_PDF_Portrait ? Remarkable_width_px : Remarkable_height_px,
-      Planner_PDF_Portrait ? Remarkable_height_px : Remarkable_width_px,
-      Remarkable_margin_width_px,
-      Planner_PDF_Start_Day,
-      Planner_PDF_Left_Handed,
-      Planner_PDF_Portrait,
-      Planner_PDF_TimeInMargin,
-      time_gap_lines,
-      time_start
-      ));
-  Test->CreateDocument();
-  Test->Build();
-  Test->FinishDocument();
-  return 0;
+  try {
+    return (true == GeneratePlanner(options)) ? 0 : 1;
+  } catch (std::exception&) {
+    std::ostream& report = (options.filename == "-") ? std::cerr : std::cout;
+    report << "[ERR] : Failed to generate " << options.filename << std::endl;
+    return 1;
+  }
 }
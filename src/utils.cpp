@@ -0,0 +1,410 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015, 2016, 2017 Howard Hinnant
+// Copyright (c) 2016 Adrian Colomitchi
+// Copyright (c) 2017 Florian Dang
+// Copyright (c) 2017 Paul Thompson
+// Copyright (c) 2018, 2019 Tomasz Kamiński
+// Copyright (c) 2019 Jiangang Zhuang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Our apologies.  When the previous paragraph was written, lowercase had not
+// yet been invented (that would involve another several millennia of
+// evolution). We did not mean to shout.
+
+#include "planner_main.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*!
+ * Advance widths of the Helvetica glyphs for the printable ASCII codes 32 to
+ * 126 in StandardEncoding, the encoding libharu uses for the base 14 fonts,
+ * in 1/1000 of the font size. Taken from the Adobe Helvetica AFM file. Codes
+ * 39 and 96 are quoteright and quoteleft in StandardEncoding.
+ */
+static const short Helvetica_widths[95] = {
+    278, 278, 355, 556, 556, 889, 667, 222, 333, 333, 389, 584,
+    278, 333, 278, 278, 556, 556, 556, 556, 556, 556, 556, 556,
+    556, 556, 278, 278, 584, 584, 584, 556, 1015, 667, 667, 722,
+    722, 667, 611, 778, 722, 278, 500, 667, 556, 833, 722, 778,
+    667, 778, 722, 667, 611, 722, 667, 944, 667, 667, 611, 278,
+    278, 278, 469, 556, 222, 556, 556, 500, 556, 556, 278, 556,
+    556, 222, 222, 500, 222, 833, 556, 556, 556, 556, 333, 500,
+    278, 556, 500, 722, 500, 500, 500, 334, 260, 334, 584};
+
+HPDF_REAL GetTextWidth(HPDF_REAL font_size, std::string_view text) {
+  /* Only ASCII text is drawn, anything else has no width */
+  std::uint32_t width = 0;
+  for (unsigned char c : text) {
+    if ((c >= 32) && (c <= 126)) {
+      width += Helvetica_widths[c - 32];
+    }
+  }
+  return width * font_size / 1000;
+}
+
+HPDF_REAL GetCenteredTextYPosition(HPDF_REAL font_size,
+                                   std::string_view text,
+                                   HPDF_REAL y_start,
+                                   HPDF_REAL y_end) {
+  return y_start + ((y_end - y_start) / 2) - font_size / 2;
+}
+
+HPDF_REAL GetCenteredTextXPosition(HPDF_REAL font_size,
+                                   std::string_view text,
+                                   HPDF_REAL x_start,
+                                   HPDF_REAL x_end) {
+  HPDF_REAL length = GetTextWidth(font_size, text);
+  return x_start + ((x_end - x_start) / 2) - length / 2;
+}
+
+bool GetCompressionMode(const std::string& name, HPDF_UINT& mode) {
+  for (auto& compression_mode : Compression_modes) {
+    if (name == compression_mode.first) {
+      mode = compression_mode.second;
+      return true;
+    }
+  }
+  return false;
+}
+
+std::string GetCompressionModeName(HPDF_UINT mode) {
+  for (auto& compression_mode : Compression_modes) {
+    if (mode == compression_mode.second) {
+      return compression_mode.first;
+    }
+  }
+  return std::to_string(mode);
+}
+
+std::string JsonEscape(const std::string& text) {
+  std::string escaped;
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+    }
+    escaped += c;
+  }
+  return escaped;
+}
+
+bool ParsePlannerOptionsJson(const std::string& json,
+                             PlannerOptions& options) {
+  const std::vector<std::string> option_names = {"start-day",
+                                                 "left-handed",
+                                                 "portrait",
+                                                 "time-in-margin",
+                                                 "compression",
+                                                 "object-streams",
+                                                 "writer",
+                                                 "precision",
+                                                 "pages-per-node",
+                                                 "jobs"};
+  std::string start_year = std::to_string(options.start_year);
+  std::string num_years = std::to_string(options.num_years);
+  std::vector<std::string> args;
+  size_t position = 0;
+
+  auto skip_spaces = [&]() {
+    while (position < json.size() && isspace((unsigned char)json[position])) {
+      position++;
+    }
+  };
+  /* Strings are returned without their quotes, anything else as it is */
+  auto parse_value = [&](std::string& value, bool& is_string) {
+    skip_spaces();
+    value.clear();
+    is_string = (position < json.size() && json[position] == '"');
+    if (is_string) {
+      for (position++; position < json.size() && json[position] != '"';
+           position++) {
+        if (json[position] == '\\' && position + 1 < json.size()) {
+          position++;
+        }
+        value += json[position];
+      }
+      if (position == json.size()) {
+        return false;
+      }
+      position++;
+      return true;
+    }
+    while (position < json.size() &&
+           (isalnum((unsigned char)json[position]) || json[position] == '-' ||
+            json[position] == '.')) {
+      value += json[position++];
+    }
+    return false == value.empty();
+  };
+
+  skip_spaces();
+  if (position == json.size() || json[position++] != '{') {
+    std::cout << "[ERR] : Expected a JSON object" << std::endl;
+    return false;
+  }
+  skip_spaces();
+  if (position < json.size() && json[position] == '}') {
+    position++;
+  }
+  while (position < json.size() && json[position - 1] != '}') {
+    std::string name;
+    std::string value;
+    bool is_string;
+    if (false == parse_value(name, is_string) || false == is_string) {
+      std::cout << "[ERR] : Expected a member name in JSON object"
+                << std::endl;
+      return false;
+    }
+    skip_spaces();
+    if (position == json.size() || json[position++] != ':' ||
+        false == parse_value(value, is_string)) {
+      std::cout << "[ERR] : Expected a value for JSON member : " << name
+                << std::endl;
+      return false;
+    }
+    if (false == is_string) {
+      if (value == "true") {
+        value = "1";
+      } else if (value == "false") {
+        value = "0";
+      }
+    }
+
+    if (name == "year" || name == "years") {
+      /* Given as positional arguments, they must not read as an option */
+      bool is_number = (false == is_string);
+      for (char c : value) {
+        is_number = is_number && isdigit((unsigned char)c);
+      }
+      if (false == is_number) {
+        std::cout << "[ERR] : Expected a number for JSON member : " << name
+                  << std::endl;
+        return false;
+      }
+      ((name == "year") ? start_year : num_years) = value;
+    } else if (std::find(option_names.begin(), option_names.end(), name) !=
+               option_names.end()) {
+      args.push_back("--" + name + "=" + value);
+    } else {
+      std::cout << "[ERR] : Unknown JSON member : " << name << std::endl;
+      return false;
+    }
+
+    skip_spaces();
+    if (position == json.size() ||
+        (json[position] != ',' && json[position] != '}')) {
+      std::cout << "[ERR] : Expected , or } in JSON object" << std::endl;
+      return false;
+    }
+    position++;
+  }
+  if (position == 0 || json[position - 1] != '}') {
+    std::cout << "[ERR] : Unterminated JSON object" << std::endl;
+    return false;
+  }
+
+  args.insert(args.begin(), {start_year, num_years});
+  return ParsePlannerOptions(args, options);
+}
+
+/**
+ * @brief
+ * A helper function to call the instance specific create thumbnail function
+ * This is a little hacky and error prone as it relies on the caller to provide
+ * the instance type. This might be helped by transitioning to std::any in the
+ * base class to store the child objects instead of shared_ptrs to PlannerBase.
+ *
+ */
+void CreateThumbnailCaller(HPDF_Doc& doc,
+                           PlannerDisplayList& display_list,
+                           HPDF_REAL x_start,
+                           HPDF_REAL y_start,
+                           HPDF_REAL x_stop,
+                           HPDF_REAL y_stop,
+                           PlannerTypes type,
+                           PlannerTypes object_type,
+                           PlannerBase* object) {
+  switch (object_type) {
+  case PlannerTypes_Month:
+    static_cast<PlannerMonth*>(object)->CreateThumbnail(
+        doc, display_list, x_start, y_start, x_stop, y_stop);
+    break;
+  default:
+    break;
+  }
+}
+
+/*!
+ * Read the value of the on/off option arg, which must be 0 or 1. Returns
+ * false, leaving is_on untouched, for any other value.
+ */
+static bool GetSwitch(const std::string& arg,
+                      const std::string& value,
+                      bool& is_on) {
+  if (value != "0" && value != "1") {
+    std::cout << "[ERR] : " << arg.substr(0, arg.find('='))
+              << " must be 0 or 1, got : " << value << std::endl;
+    return false;
+  }
+  is_on = (value == "1");
+  return true;
+}
+
+bool ParsePlannerOptions(const std::vector<std::string>& args,
+                         PlannerOptions& options) {
+  /* Options are given as --name=value, everything else is positional */
+  std::vector<std::string> positional_args;
+  for (auto& arg : args) {
+    std::string value = arg.substr(arg.find('=') + 1);
+    if (arg.rfind("--compression=", 0) == 0) {
+      if (false == GetCompressionMode(value, options.compression_mode)) {
+        std::cout << "[ERR] : Unknown compression mode : " << value
+                  << ", expected one of none, text, image, metadata, all"
+                  << std::endl;
+        return false;
+      }
+    } else if (arg.rfind("--start-day=", 0) == 0) {
+      int start_day_cl = atoi(value.c_str());
+      if ((start_day_cl < 0) || (start_day_cl > 6)) {
+        std::cout << "[ERR] : Start day must be between 0 (Sunday) and 6 "
+                     "(Saturday), got : "
+                  << value << std::endl;
+        return false;
+      }
+      options.start_day = start_day_cl;
+    } else if (arg.rfind("--left-handed=", 0) == 0) {
+      if (false == GetSwitch(arg, value, options.is_left_handed)) {
+        return false;
+      }
+    } else if (arg.rfind("--portrait=", 0) == 0) {
+      if (false == GetSwitch(arg, value, options.is_portrait)) {
+        return false;
+      }
+    } else if (arg.rfind("--time-in-margin=", 0) == 0) {
+      if (false == GetSwitch(arg, value, options.time_in_margin)) {
+        return false;
+      }
+    } else if (arg.rfind("--jobs=", 0) == 0) {
+      int num_jobs_cl = atoi(value.c_str());
+      if (num_jobs_cl > 0) {
+        options.num_jobs = num_jobs_cl;
+      } else {
+        options.num_jobs = std::max(1u, std::thread::hardware_concurrency());
+      }
+    } else if (arg.rfind("--batch=", 0) == 0) {
+      options.batch_file = value;
+    } else if (arg.rfind("--pages-per-node=", 0) == 0) {
+      options.pages_per_node = atoi(value.c_str());
+      if (options.pages_per_node < -1) {
+        std::cout << "[ERR] : Pages per node must be -1 (balanced), 0 (flat) "
+                     "or a number of pages, got : "
+                  << value << std::endl;
+        return false;
+      }
+    } else if (arg.rfind("--object-streams=", 0) == 0) {
+      if (false == GetSwitch(arg, value, options.object_streams)) {
+        return false;
+      }
+    } else if (arg.rfind("--precision=", 0) == 0) {
+      options.precision = atoi(value.c_str());
+      if (options.precision < 0 || options.precision > 5) {
+        std::cout << "[ERR] : Precision must be between 0 and 5 decimals, "
+                     "got : "
+                  << value << std::endl;
+        return false;
+      }
+    } else if (arg.rfind("--writer=", 0) == 0) {
+      if (value != "libharu" && value != "native") {
+        std::cout << "[ERR] : Unknown writer : " << value
+                  << ", expected libharu or native" << std::endl;
+        return false;
+      }
+      options.native_writer = (value == "native");
+    } else if (arg.rfind("--extend=", 0) == 0) {
+      options.extend_file = value;
+    } else if (arg.rfind("--cache-dir=", 0) == 0) {
+      options.cache_dir = value;
+    } else if (arg.rfind("--serve=", 0) == 0) {
+      options.serve_socket = value;
+    } else if (arg.rfind("--serve-cache=", 0) == 0) {
+      options.serve_cache_size = std::max(0, atoi(value.c_str()));
+    } else if (arg == "--stats") {
+      options.stats = true;
+    } else if (arg.rfind("--", 0) == 0) {
+      /* A mistyped or newer option must not end up as a positional value */
+      std::cout << "[ERR] : Unknown option : " << arg << std::endl;
+      return false;
+    } else {
+      positional_args.push_back(arg);
+    }
+  }
+
+  if (positional_args.size() > 0) {
+    int start_year_cl = atoi(positional_args[0].c_str());
+    if ((start_year_cl != 0) && (start_year_cl < 3000)) {
+      options.start_year = start_year_cl;
+    }
+  }
+
+  if (positional_args.size() > 1) {
+    int num_years_cl = atoi(positional_args[1].c_str());
+    if ((num_years_cl > 0) && (num_years_cl < 100)) {
+      options.num_years = num_years_cl;
+    }
+  }
+
+  if (positional_args.size() > 2) {
+    options.filename = positional_args[2];
+  }
+
+  if (false == options.extend_file.empty() && options.num_years < 2) {
+    std::cout << "[ERR] : Extending a planner needs at least 2 years, the "
+                 "existing years and the year to add"
+              << std::endl;
+    return false;
+  }
+
+  if (false == options.extend_file.empty() &&
+      false == options.serve_socket.empty()) {
+    std::cout << "[ERR] : Planners cannot be extended in serve mode"
+              << std::endl;
+    return false;
+  }
+
+  if (positional_args.size() > 3) {
+    int time_gap_lines_cl = atoi(positional_args[3].c_str());
+    if((time_gap_lines_cl > 0) && (time_gap_lines_cl < 10)) {
+      options.time_gap_lines = time_gap_lines_cl;
+    }
+  }
+  if (positional_args.size() > 4) {
+    int time_start_cl = atoi(positional_args[4].c_str());
+    if((time_start_cl > 0) && (time_start_cl < 10)) {
+      options.time_start = time_start_cl;
+    }
+  }
+  return true;
+}
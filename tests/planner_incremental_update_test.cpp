@@ -0,0 +1,209 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015, 2016, 2017 Howard Hinnant
+// Copyright (c) 2016 Adrian Colomitchi
+// Copyright (c) 2017 Florian Dang
+// Copyright (c) 2017 Paul Thompson
+// Copyright (c) 2018, 2019 Tomasz Kamiński
+// Copyright (c) 2019 Jiangang Zhuang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Our apologies.  When the previous paragraph was written, lowercase had not
+// yet been invented (that would involve another several millennia of
+// evolution). We did not mean to shout.
+
+
+#include "planner_main.hpp"
+#include "planner_pdf_file.hpp"
+#include "planner_test.hpp"
+#include "utils.hpp"
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+/*! What a page shows: its decoded content and where its links go */
+struct PageContents {
+  std::string content;
+  /*! The rectangle of each link and the index of the page it shows */
+  std::vector<std::pair<std::string, size_t>> links;
+};
+
+/*!
+ * Build a native planner of num_years years from 2024 to filename, adding
+ * the last year to extend_filename if it is not empty. Returns whether it
+ * was saved.
+ */
+static bool Generate(const std::string& filename,
+                     short num_years,
+                     const std::string& extend_filename) {
+  PlannerOptions options;
+  PlannerMain planner(2024,
+                      filename,
+                      num_years,
+                      Remarkable_height_px,
+                      Remarkable_width_px,
+                      Remarkable_margin_width_px,
+                      options.start_day,
+                      options.is_left_handed,
+                      options.is_portrait,
+                      options.time_in_margin,
+                      options.time_gap_lines,
+                      options.time_start,
+                      HPDF_COMP_ALL);
+  planner.SetNativeWriter(true);
+  planner.SetExtendFile(extend_filename);
+  planner.CreateDocument();
+  planner.Build();
+  return planner.FinishDocument();
+}
+
+static std::string ReadFile(const std::string& filename) {
+  std::ifstream file(filename, std::ios::binary);
+  return std::string((std::istreambuf_iterator<char>(file)),
+                     std::istreambuf_iterator<char>());
+}
+
+/*! The value of object number, following it if value is a reference */
+static std::string Resolve(const PlannerPdfFile& file,
+                           const std::string& value) {
+  std::uint32_t number;
+  return (true == PlannerPdfFile::GetReference(value, number))
+             ? file.GetValue(number)
+             : value;
+}
+
+/*! The data of the stream object number, inflated if it is compressed */
+static std::string GetStreamData(const PlannerPdfFile& file,
+                                 std::uint32_t number) {
+  const PlannerPdfFile::PdfObject* object = file.GetObject(number);
+  PLANNER_CHECK(NULL != object && true == object->is_stream);
+  if (NULL == object || false == object->is_stream) {
+    return "";
+  }
+  std::string dictionary = file.GetValue(number);
+  size_t length = std::stoul(
+      Resolve(file, PlannerPdfFile::GetEntry(dictionary, "/Length")));
+  const std::string& pdf = file.GetData();
+  size_t start = pdf.find("stream", object->dictionary_end) + 6;
+  start += (pdf[start] == '\r') ? 2 : 1;
+  std::string data = pdf.substr(start, length);
+  if (PlannerPdfFile::GetEntry(dictionary, "/Filter") != "/FlateDecode") {
+    return data;
+  }
+  std::string inflated(data.size() * 8 + 1024, '\0');
+  uLongf inflated_size = inflated.size();
+  while (Z_BUF_ERROR == uncompress((Bytef*)&inflated[0],
+                                   &inflated_size,
+                                   (const Bytef*)data.data(),
+                                   data.size())) {
+    inflated.resize(inflated.size() * 2);
+    inflated_size = inflated.size();
+  }
+  inflated.resize(inflated_size);
+  return inflated;
+}
+
+/*! Read what every page of pdf shows, in page order */
+static std::vector<PageContents> GetPageContents(const std::string& pdf) {
+  std::vector<PageContents> pages;
+  PlannerPdfFile file;
+  std::vector<std::uint32_t> page_numbers;
+  PLANNER_CHECK(true == file.Read(pdf));
+  PLANNER_CHECK(true == file.GetPages(page_numbers));
+  std::map<std::uint32_t, size_t> page_indexes;
+  for (size_t index = 0; index < page_numbers.size(); index++) {
+    page_indexes[page_numbers[index]] = index;
+  }
+
+  for (std::uint32_t page_number : page_numbers) {
+    PageContents page;
+    std::string dictionary = file.GetValue(page_number);
+    for (auto& stream : PlannerPdfFile::GetReferences(
+             PlannerPdfFile::GetEntry(dictionary, "/Contents"))) {
+      page.content += GetStreamData(file, stream.number);
+    }
+    for (auto& annotation : PlannerPdfFile::GetReferences(
+             PlannerPdfFile::GetEntry(dictionary, "/Annots"))) {
+      std::string link = file.GetValue(annotation.number);
+      std::vector<PlannerPdfFile::Reference> target =
+          PlannerPdfFile::GetReferences(
+              Resolve(file, PlannerPdfFile::GetEntry(link, "/Dest")));
+      PLANNER_CHECK(false == target.empty() &&
+                    page_indexes.count(target[0].number) > 0);
+      if (true == target.empty() || 0 == page_indexes.count(target[0].number)) {
+        continue;
+      }
+      page.links.emplace_back(PlannerPdfFile::GetEntry(link, "/Rect"),
+                              page_indexes[target[0].number]);
+    }
+    pages.push_back(page);
+  }
+  return pages;
+}
+
+int main() {
+  std::filesystem::path directory =
+      std::filesystem::temp_directory_path() / "planner_incremental_update_test";
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directories(directory);
+  std::string original = (directory / "original.pdf").string();
+  std::string extended = (directory / "extended.pdf").string();
+  std::string complete = (directory / "complete.pdf").string();
+
+  /* Adding a year, also across the leap year, shows the same pages with
+   * the same links as building the longer planner from scratch */
+  for (short num_years : {1, 2}) {
+    PLANNER_CHECK(true == Generate(original, num_years, ""));
+    PLANNER_CHECK(true == Generate(extended, num_years + 1, original));
+    PLANNER_CHECK(true == Generate(complete, num_years + 1, ""));
+
+    std::string original_pdf = ReadFile(original);
+    std::string extended_pdf = ReadFile(extended);
+    PLANNER_CHECK(0 == extended_pdf.compare(0, original_pdf.size(),
+                                            original_pdf));
+    std::vector<PageContents> extended_pages = GetPageContents(extended_pdf);
+    std::vector<PageContents> complete_pages =
+        GetPageContents(ReadFile(complete));
+    PLANNER_CHECK(false == complete_pages.empty());
+    PLANNER_CHECK(extended_pages.size() == complete_pages.size());
+    for (size_t index = 0; index < extended_pages.size() &&
+                           index < complete_pages.size();
+         index++) {
+      PLANNER_CHECK(extended_pages[index].content ==
+                    complete_pages[index].content);
+      PLANNER_CHECK(extended_pages[index].links ==
+                    complete_pages[index].links);
+    }
+  }
+
+  /* A planner which is not one year shorter is rejected and nothing is
+   * written */
+  std::filesystem::remove(extended);
+  PLANNER_CHECK(true == Generate(original, 1, ""));
+  PLANNER_CHECK(false == Generate(extended, 3, original));
+  PLANNER_CHECK(false == std::filesystem::exists(extended));
+
+  std::filesystem::remove_all(directory);
+  return PlannerTestResult();
+}
@@ -0,0 +1,107 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015, 2016, 2017 Howard Hinnant
+// Copyright (c) 2016 Adrian Colomitchi
+// Copyright (c) 2017 Florian Dang
+// Copyright (c) 2017 Paul Thompson
+// Copyright (c) 2018, 2019 Tomasz Kamiński
+// Copyright (c) 2019 Jiangang Zhuang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Our apologies.  When the previous paragraph was written, lowercase had not
+// yet been invented (that would involve another several millennia of
+// evolution). We did not mean to shout.
+
+
+#include "planner_main.hpp"
+#include "planner_test.hpp"
+#include "utils.hpp"
+#include <fstream>
+#include <string>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+#include <unistd.h>
+
+/*! The number of planners built once the memory in use has settled */
+static const int Num_builds = 8;
+/*! The growth of the resident memory allowed over all those builds */
+static const long Max_growth_bytes = 1024 * 1024;
+
+/*!
+ * The resident memory of the process in bytes, after handing the freed
+ * memory back to the system where the allocator allows it
+ */
+static long GetResidentBytes() {
+#if defined(__GLIBC__)
+  malloc_trim(0);
+#endif
+  long size = 0;
+  long resident = 0;
+  std::ifstream statm("/proc/self/statm");
+  statm >> size >> resident;
+  return resident * sysconf(_SC_PAGESIZE);
+}
+
+/*!
+ * Build a three year planner with the given writer into memory and free it
+ * with everything it allocated
+ */
+static void BuildAndFree(bool use_native_writer) {
+  PlannerOptions options;
+  std::string pdf;
+  auto planner = std::make_shared<PlannerMain>(options.start_year,
+                                               "memory_test.pdf",
+                                               3,
+                                               Remarkable_height_px,
+                                               Remarkable_width_px,
+                                               Remarkable_margin_width_px,
+                                               options.start_day,
+                                               options.is_left_handed,
+                                               options.is_portrait,
+                                               options.time_in_margin,
+                                               options.time_gap_lines,
+                                               options.time_start,
+                                               options.compression_mode);
+  planner->SetNativeWriter(use_native_writer);
+  planner->CreateDocument();
+  planner->Build();
+  planner->SaveToMemory(pdf);
+  PLANNER_CHECK(false == pdf.empty());
+}
+
+int main() {
+  for (bool use_native_writer : {true, false}) {
+    /* The first build allocates what lives for the whole process, such as
+     * the string tables and the allocator's own arenas */
+    BuildAndFree(use_native_writer);
+    long baseline = GetResidentBytes();
+    for (int build = 0; build < Num_builds; build++) {
+      BuildAndFree(use_native_writer);
+    }
+    long growth = GetResidentBytes() - baseline;
+    std::cout << "[INFO] : Resident memory grew by " << growth
+              << " bytes over " << Num_builds << " builds with the "
+              << (use_native_writer ? "native" : "libharu") << " writer"
+              << std::endl;
+    PLANNER_CHECK(growth < Max_growth_bytes);
+  }
+  return PlannerTestResult();
+}
@@ -0,0 +1,248 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015, 2016, 2017 Howard Hinnant
+// Copyright (c) 2016 Adrian Colomitchi
+// Copyright (c) 2017 Florian Dang
+// Copyright (c) 2017 Paul Thompson
+// Copyright (c) 2018, 2019 Tomasz Kamiński
+// Copyright (c) 2019 Jiangang Zhuang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Our apologies.  When the previous paragraph was written, lowercase had not
+// yet been invented (that would involve another several millennia of
+// evolution). We did not mean to shout.
+
+
+#include "planner_main.hpp"
+#include "planner_object_streams.hpp"
+#include "planner_pdf_file.hpp"
+#include "planner_test.hpp"
+#include "utils.hpp"
+#include <map>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+/*! A stream object of the packed file, read from its offset */
+struct PackedStream {
+  std::uint32_t number;
+  std::string dictionary;
+  std::string data;
+};
+
+/*!
+ * Read the stream object starting at offset of pdf, inflating its data.
+ * Returns false if there is no stream object there.
+ */
+static bool ReadStream(const std::string& pdf,
+                       size_t offset,
+                       PackedStream& stream) {
+  PlannerPdfFile::Token number =
+      PlannerPdfFile::NextToken(pdf, offset, pdf.size());
+  PlannerPdfFile::Token generation =
+      PlannerPdfFile::NextToken(pdf, number.end, pdf.size());
+  PlannerPdfFile::Token keyword =
+      PlannerPdfFile::NextToken(pdf, generation.end, pdf.size());
+  if (number.start != offset || number.kind != PlannerPdfFile::Token_Number ||
+      0 != pdf.compare(keyword.start, keyword.end - keyword.start, "obj")) {
+    return false;
+  }
+  size_t dictionary_start =
+      PlannerPdfFile::NextToken(pdf, keyword.end, pdf.size()).start;
+  size_t dictionary_end =
+      PlannerPdfFile::SkipValue(pdf, keyword.end, pdf.size());
+  if (dictionary_end == std::string::npos) {
+    return false;
+  }
+  stream.number = strtoul(pdf.c_str() + number.start, NULL, 10);
+  stream.dictionary =
+      pdf.substr(dictionary_start, dictionary_end - dictionary_start);
+  size_t length = strtoul(
+      PlannerPdfFile::GetEntry(stream.dictionary, "/Length").c_str(), NULL,
+      10);
+  size_t data_start = pdf.find("stream", dictionary_end);
+  if (data_start == std::string::npos ||
+      PlannerPdfFile::GetEntry(stream.dictionary, "/Filter") !=
+          "/FlateDecode") {
+    return false;
+  }
+  data_start += 6;
+  data_start += (pdf[data_start] == '\r') ? 2 : 1;
+  stream.data.assign(length * 8 + 1024, '\0');
+  uLongf size = stream.data.size();
+  int result;
+  while (Z_BUF_ERROR ==
+         (result = uncompress((Bytef*)&stream.data[0],
+                              &size,
+                              (const Bytef*)pdf.data() + data_start,
+                              length))) {
+    stream.data.resize(stream.data.size() * 2);
+    size = stream.data.size();
+  }
+  stream.data.resize(size);
+  return Z_OK == result;
+}
+
+/*! Read a big endian field of the given width from row */
+static std::uint64_t GetField(const std::string& row, size_t start, int width) {
+  std::uint64_t value = 0;
+  for (int index = 0; index < width; index++) {
+    value = (value << 8) | (std::uint8_t)row[start + index];
+  }
+  return value;
+}
+
+/*!
+ * The value of object number in the original file, as it is packed: from
+ * after obj to before endobj without surrounding white space
+ */
+static std::string GetOriginalValue(const PlannerPdfFile& original,
+                                    std::uint32_t number) {
+  const PlannerPdfFile::PdfObject* object = original.GetObject(number);
+  if (NULL == object) {
+    return "";
+  }
+  return original.GetData().substr(object->value_start,
+                                   object->value_end - object->value_start);
+}
+
+int main() {
+  PlannerOptions options;
+  PlannerMain planner(2024,
+                      "object_streams_test.pdf",
+                      1,
+                      Remarkable_height_px,
+                      Remarkable_width_px,
+                      Remarkable_margin_width_px,
+                      options.start_day,
+                      options.is_left_handed,
+                      options.is_portrait,
+                      options.time_in_margin,
+                      options.time_gap_lines,
+                      options.time_start,
+                      HPDF_COMP_ALL);
+  planner.SetNativeWriter(true);
+  planner.CreateDocument();
+  planner.Build();
+  std::string pdf;
+  planner.SaveToMemory(pdf);
+
+  std::string packed;
+  PLANNER_CHECK(true == PlannerObjectStreams::Pack(pdf, packed));
+  PLANNER_CHECK(0 == packed.rfind("%PDF-1.5", 0));
+  PlannerPdfFile original;
+  PLANNER_CHECK(true == original.Read(pdf));
+
+  /* The cross-reference stream the file ends with */
+  size_t startxref = packed.rfind("startxref");
+  PLANNER_CHECK(startxref != std::string::npos);
+  if (startxref == std::string::npos) {
+    return PlannerTestResult();
+  }
+  PackedStream xref;
+  PLANNER_CHECK(true == ReadStream(packed,
+                                   strtoull(packed.c_str() + startxref + 9,
+                                            NULL, 10),
+                                   xref));
+  PLANNER_CHECK(PlannerPdfFile::GetEntry(xref.dictionary, "/Type") == "/XRef");
+  PLANNER_CHECK(PlannerPdfFile::GetEntry(xref.dictionary, "/W") ==
+                "[ 1 4 2 ]");
+  PLANNER_CHECK(PlannerPdfFile::GetEntry(xref.dictionary, "/Root") ==
+                PlannerPdfFile::GetEntry(original.GetTrailer(), "/Root"));
+  const size_t row_size = 1 + 4 + 2;
+  std::uint32_t size = strtoul(
+      PlannerPdfFile::GetEntry(xref.dictionary, "/Size").c_str(), NULL, 10);
+  PLANNER_CHECK(size > original.GetSize());
+  PLANNER_CHECK(xref.data.size() == size * row_size);
+
+  /* Every entry resolves to its object number, and every object of the
+   * original file is there with the same value */
+  std::map<std::uint64_t, PackedStream> object_streams;
+  std::vector<bool> is_listed(size, false);
+  size_t num_packed = 0;
+  for (std::uint32_t number = 0;
+       number < size && (number + 1) * row_size <= xref.data.size();
+       number++) {
+    std::string row = xref.data.substr(number * row_size, row_size);
+    std::uint8_t type = GetField(row, 0, 1);
+    std::uint64_t field2 = GetField(row, 1, 4);
+    std::uint32_t field3 = GetField(row, 5, 2);
+    if (0 == type) {
+      PLANNER_CHECK(0 == number);
+      continue;
+    }
+    is_listed[number] = true;
+    if (1 == type) {
+      std::string header = std::to_string(number) + " " +
+                           std::to_string(field3) + " obj";
+      PLANNER_CHECK(0 == packed.compare(field2, header.size(), header));
+      continue;
+    }
+    PLANNER_CHECK(2 == type);
+    if (0 == object_streams.count(field2)) {
+      std::string stream_row = xref.data.substr(field2 * row_size, row_size);
+      PLANNER_CHECK(field2 < size && 1 == GetField(stream_row, 0, 1));
+      PLANNER_CHECK(true == ReadStream(packed,
+                                       GetField(stream_row, 1, 4),
+                                       object_streams[field2]));
+    }
+    const PackedStream& object_stream = object_streams[field2];
+    PLANNER_CHECK(object_stream.number == field2);
+    PLANNER_CHECK(PlannerPdfFile::GetEntry(object_stream.dictionary,
+                                           "/Type") == "/ObjStm");
+    std::uint32_t count = strtoul(
+        PlannerPdfFile::GetEntry(object_stream.dictionary, "/N").c_str(), NULL,
+        10);
+    size_t first = strtoul(
+        PlannerPdfFile::GetEntry(object_stream.dictionary, "/First").c_str(),
+        NULL, 10);
+    PLANNER_CHECK(field3 < count);
+
+    /* The index-th pair of the header is the object number and offset */
+    const std::string& data = object_stream.data;
+    size_t position = 0;
+    PlannerPdfFile::Token token = {PlannerPdfFile::Token_End, 0, 0};
+    std::uint64_t pair[2] = {0, 0};
+    for (std::uint32_t field = 0; field < 2 * field3 + 2; field++) {
+      token = PlannerPdfFile::NextToken(data, position, first);
+      PLANNER_CHECK(token.kind == PlannerPdfFile::Token_Number);
+      pair[field % 2] = strtoull(data.c_str() + token.start, NULL, 10);
+      position = token.end;
+    }
+    PLANNER_CHECK(pair[0] == number);
+    size_t value_start = first + pair[1];
+    size_t value_end =
+        PlannerPdfFile::SkipValue(data, value_start, data.size());
+    PLANNER_CHECK(value_end != std::string::npos);
+    if (value_end != std::string::npos) {
+      value_start = PlannerPdfFile::NextToken(data, value_start, value_end).start;
+      PLANNER_CHECK(data.substr(value_start, value_end - value_start) ==
+                    GetOriginalValue(original, number));
+    }
+    num_packed++;
+  }
+  for (std::uint32_t number = 1; number < original.GetSize(); number++) {
+    PLANNER_CHECK(NULL == original.GetObject(number) ||
+                  (number < size && true == is_listed[number]));
+  }
+  PLANNER_CHECK(num_packed > 0);
+  PLANNER_CHECK(false == object_streams.empty());
+  return PlannerTestResult();
+}
@@ -0,0 +1,109 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015, 2016, 2017 Howard Hinnant
+// Copyright (c) 2016 Adrian Colomitchi
+// Copyright (c) 2017 Florian Dang
+// Copyright (c) 2017 Paul Thompson
+// Copyright (c) 2018, 2019 Tomasz Kamiński
+// Copyright (c) 2019 Jiangang Zhuang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Our apologies.  When the previous paragraph was written, lowercase had not
+// yet been invented (that would involve another several millennia of
+// evolution). We did not mean to shout.
+
+#include "planner_test.hpp"
+#include "utils.hpp"
+#include <string>
+#include <vector>
+
+/*! Parse args on top of the default options */
+static bool Parse(const std::vector<std::string>& args,
+                  PlannerOptions& options) {
+  options = PlannerOptions();
+  return ParsePlannerOptions(args, options);
+}
+
+int main() {
+  PlannerOptions options;
+
+  PLANNER_CHECK(true == Parse({"2024", "3", "planner_2024.pdf",
+                               "--start-day=1", "--stats"},
+                              options));
+  PLANNER_CHECK(2024 == options.start_year);
+  PLANNER_CHECK(3 == options.num_years);
+  PLANNER_CHECK("planner_2024.pdf" == options.filename);
+  PLANNER_CHECK(1 == options.start_day);
+  PLANNER_CHECK(true == options.stats);
+
+  /* A filename of - is the standard output, not an option */
+  PLANNER_CHECK(true == Parse({"2024", "1", "-"}, options));
+  PLANNER_CHECK("-" == options.filename);
+
+  /* Mistyped and unknown options are rejected instead of being positional */
+  PLANNER_CHECK(false == Parse({"--year=2024"}, options));
+  PLANNER_CHECK(false == Parse({"2024", "--years=3", "planner.pdf"}, options));
+  PLANNER_CHECK(false == Parse({"--start_day=1"}, options));
+  PLANNER_CHECK(false == Parse({"--stats=1"}, options));
+  PLANNER_CHECK(false == Parse({"--"}, options));
+
+  /* Known options keep validating their values */
+  PLANNER_CHECK(false == Parse({"--start-day=7"}, options));
+  PLANNER_CHECK(false == Parse({"--precision=6"}, options));
+  PLANNER_CHECK(false == Parse({"--writer=other"}, options));
+  PLANNER_CHECK(false == Parse({"--portrait=yes"}, options));
+  PLANNER_CHECK(false == Parse({"--left-handed=2"}, options));
+  PLANNER_CHECK(false == Parse({"--time-in-margin="}, options));
+  PLANNER_CHECK(false == Parse({"--object-streams=on"}, options));
+  PLANNER_CHECK(true == Parse({"--portrait=1", "--left-handed=1",
+                               "--time-in-margin=0", "--object-streams=1"},
+                              options));
+  PLANNER_CHECK(true == options.is_portrait);
+  PLANNER_CHECK(true == options.is_left_handed);
+  PLANNER_CHECK(false == options.time_in_margin);
+  PLANNER_CHECK(true == options.object_streams);
+
+  /* Unknown JSON members are rejected the same way */
+  options = PlannerOptions();
+  PLANNER_CHECK(true == ParsePlannerOptionsJson(
+                            "{\"year\": 2025, \"years\": 2, \"portrait\": 1}",
+                            options));
+  PLANNER_CHECK(2025 == options.start_year);
+  PLANNER_CHECK(true == options.is_portrait);
+  PLANNER_CHECK(true == ParsePlannerOptionsJson("{\"left-handed\": true}",
+                                                options));
+  PLANNER_CHECK(true == options.is_left_handed);
+  PLANNER_CHECK(false == ParsePlannerOptionsJson("{\"portrait\": \"yes\"}",
+                                                 options));
+  PLANNER_CHECK(false == ParsePlannerOptionsJson("{\"yeer\": 2025}", options));
+
+  /* Served requests cannot choose where anything is written */
+  options = PlannerOptions();
+  PLANNER_CHECK(false == ParsePlannerOptionsJson(
+                             "{\"cache-dir\": \"/tmp/cache\"}", options));
+  PLANNER_CHECK(false == ParsePlannerOptionsJson(
+                             "{\"year\": \"--cache-dir=/tmp\"}", options));
+  PLANNER_CHECK(false == ParsePlannerOptionsJson(
+                             "{\"years\": \"--extend=/tmp/a.pdf\"}", options));
+  PLANNER_CHECK(true == options.cache_dir.empty());
+  PLANNER_CHECK(true == options.extend_file.empty());
+
+  return PlannerTestResult();
+}
@@ -0,0 +1,153 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015, 2016, 2017 Howard Hinnant
+// Copyright (c) 2016 Adrian Colomitchi
+// Copyright (c) 2017 Florian Dang
+// Copyright (c) 2017 Paul Thompson
+// Copyright (c) 2018, 2019 Tomasz Kamiński
+// Copyright (c) 2019 Jiangang Zhuang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Our apologies.  When the previous paragraph was written, lowercase had not
+// yet been invented (that would involve another several millennia of
+// evolution). We did not mean to shout.
+
+
+#include "planner_main.hpp"
+#include "planner_test.hpp"
+#include "utils.hpp"
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <unistd.h>
+
+/*!
+ * A two year planner, enough for libharu's output to be read in several
+ * chunks and the native writer's to be handed on several times when it is
+ * streamed
+ */
+static std::unique_ptr<PlannerMain> CreatePlanner(const std::string& filename,
+                                                  bool use_native_writer,
+                                                  bool use_object_streams) {
+  PlannerOptions options;
+  auto planner = std::make_unique<PlannerMain>(2024,
+                                               filename,
+                                               2,
+                                               Remarkable_height_px,
+                                               Remarkable_width_px,
+                                               Remarkable_margin_width_px,
+                                               options.start_day,
+                                               options.is_left_handed,
+                                               options.is_portrait,
+                                               options.time_in_margin,
+                                               options.time_gap_lines,
+                                               options.time_start,
+                                               HPDF_COMP_NONE);
+  planner->SetNativeWriter(use_native_writer);
+  planner->SetObjectStreams(use_object_streams);
+  return planner;
+}
+
+static std::string ReadFile(const std::string& filename) {
+  std::ifstream file(filename, std::ios::binary);
+  return std::string((std::istreambuf_iterator<char>(file)),
+                     std::istreambuf_iterator<char>());
+}
+
+/*!
+ * Check that every way of saving a planner writes the same document as
+ * SaveToMemory, and that a failed write is reported
+ */
+static void CheckOutputs(bool use_native_writer, bool use_object_streams) {
+  std::string filename =
+      (std::filesystem::temp_directory_path() / "planner_output_test.pdf")
+          .string();
+  std::string pdf;
+  auto planner = CreatePlanner(filename, use_native_writer, use_object_streams);
+  planner->CreateDocument();
+  planner->Build();
+  planner->SaveToMemory(pdf);
+  PLANNER_CHECK(false == pdf.empty());
+
+  /* The sink gets the document in order, in chunks when it is long */
+  std::string sunk;
+  size_t num_chunks = 0;
+  planner = CreatePlanner(filename, use_native_writer, use_object_streams);
+  planner->CreateDocument();
+  planner->Build();
+  PLANNER_CHECK(true == planner->SaveToSink(
+                            [&](const HPDF_BYTE* data, HPDF_UINT32 size) {
+                              sunk.append((const char*)data, size);
+                              num_chunks++;
+                              return true;
+                            }));
+  PLANNER_CHECK(pdf == sunk);
+  if (false == use_native_writer && false == use_object_streams) {
+    PLANNER_CHECK(num_chunks > 1);
+  }
+
+  /* A failing sink is not called again and the failure is returned */
+  num_chunks = 0;
+  planner = CreatePlanner(filename, use_native_writer, use_object_streams);
+  planner->CreateDocument();
+  planner->Build();
+  PLANNER_CHECK(false == planner->SaveToSink(
+                             [&](const HPDF_BYTE* data, HPDF_UINT32 size) {
+                               num_chunks++;
+                               return false;
+                             }));
+  PLANNER_CHECK(1 == num_chunks);
+
+  /* A file descriptor gets the whole document, an invalid one fails */
+  int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  PLANNER_CHECK(fd >= 0);
+  planner = CreatePlanner(filename, use_native_writer, use_object_streams);
+  planner->CreateDocument();
+  planner->Build();
+  PLANNER_CHECK(true == planner->SaveToFileDescriptor(fd));
+  close(fd);
+  PLANNER_CHECK(pdf == ReadFile(filename));
+  planner = CreatePlanner(filename, use_native_writer, use_object_streams);
+  planner->CreateDocument();
+  planner->Build();
+  PLANNER_CHECK(false == planner->SaveToFileDescriptor(-1));
+
+  /* The native writer streams the pages to the file while they are built */
+  std::filesystem::remove(filename);
+  planner = CreatePlanner(filename, use_native_writer, use_object_streams);
+  planner->SetStreamed(true);
+  planner->CreateDocument();
+  planner->Build();
+  PLANNER_CHECK(true == planner->FinishDocument());
+  PLANNER_CHECK(pdf == ReadFile(filename));
+  std::filesystem::remove(filename);
+}
+
+int main() {
+  for (bool use_native_writer : {true, false}) {
+    for (bool use_object_streams : {false, true}) {
+      CheckOutputs(use_native_writer, use_object_streams);
+    }
+  }
+  return PlannerTestResult();
+}
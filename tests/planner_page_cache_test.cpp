@@ -0,0 +1,108 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015, 2016, 2017 Howard Hinnant
+// Copyright (c) 2016 Adrian Colomitchi
+// Copyright (c) 2017 Florian Dang
+// Copyright (c) 2017 Paul Thompson
+// Copyright (c) 2018, 2019 Tomasz Kamiński
+// Copyright (c) 2019 Jiangang Zhuang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Our apologies.  When the previous paragraph was written, lowercase had not
+// yet been invented (that would involve another several millennia of
+// evolution). We did not mean to shout.
+
+#include "planner_pdf_writer.hpp"
+
+#include "planner_main.hpp"
+#include "planner_test.hpp"
+#include "utils.hpp"
+#include <filesystem>
+#include <sstream>
+#include <string>
+
+/*!
+ * Generate a one year planner with the native writer into pdf, with the
+ * page cache in cache_dir if it is not empty, and return its statistics
+ */
+static std::string Generate(const std::string& cache_dir,
+                            HPDF_UINT compression_mode,
+                            std::string& pdf) {
+  PlannerOptions options;
+  PlannerMain planner(2024,
+                      "cache_test.pdf",
+                      1,
+                      Remarkable_height_px,
+                      Remarkable_width_px,
+                      Remarkable_margin_width_px,
+                      options.start_day,
+                      options.is_left_handed,
+                      options.is_portrait,
+                      options.time_in_margin,
+                      options.time_gap_lines,
+                      options.time_start,
+                      compression_mode);
+  planner.SetNativeWriter(true);
+  planner.SetPageCacheDirectory(cache_dir);
+  planner.CreateDocument();
+  planner.Build();
+  planner.SaveToMemory(pdf);
+  std::ostringstream stats;
+  planner.PrintStats(stats);
+  return stats.str();
+}
+
+/*! The counters of what was written to the document, from its statistics */
+static std::string GetCounters(const std::string& stats) {
+  size_t start = stats.find("\"pages\"");
+  return stats.substr(start, stats.find("\"cache_hits\"") - start);
+}
+
+int main() {
+  std::string cache_dir =
+      (std::filesystem::temp_directory_path() / "planner_page_cache_test")
+          .string();
+  std::filesystem::remove_all(cache_dir);
+
+  for (HPDF_UINT compression_mode : {HPDF_COMP_NONE, HPDF_COMP_ALL}) {
+    std::string uncached;
+    std::string stored;
+    std::string loaded;
+    Generate("", compression_mode, uncached);
+    std::string stored_stats = Generate(cache_dir, compression_mode, stored);
+    std::string loaded_stats = Generate(cache_dir, compression_mode, loaded);
+
+    /* Every page of the second run is written from the cache */
+    PLANNER_CHECK(std::string::npos !=
+                  stored_stats.find("\"cache_hits\": 0,"));
+    PLANNER_CHECK(std::string::npos !=
+                  loaded_stats.find("\"cache_misses\": 0,"));
+    PLANNER_CHECK(GetCounters(stored_stats) == GetCounters(loaded_stats));
+
+    /* The output does not depend on the cache, nor on the pages stored in
+     * it with other settings */
+    PLANNER_CHECK(false == uncached.empty());
+    PLANNER_CHECK(uncached == stored);
+    PLANNER_CHECK(uncached == loaded);
+  }
+
+  std::filesystem::remove_all(cache_dir);
+  return PlannerTestResult();
+}
@@ -0,0 +1,155 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015, 2016, 2017 Howard Hinnant
+// Copyright (c) 2016 Adrian Colomitchi
+// Copyright (c) 2017 Florian Dang
+// Copyright (c) 2017 Paul Thompson
+// Copyright (c) 2018, 2019 Tomasz Kamiński
+// Copyright (c) 2019 Jiangang Zhuang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Our apologies.  When the previous paragraph was written, lowercase had not
+// yet been invented (that would involve another several millennia of
+// evolution). We did not mean to shout.
+
+#include "planner_pdf_writer.hpp"
+#include "planner_test.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+/*!
+ * Check that value written with decimals reads back as the value rounded to
+ * decimals, in its shortest form
+ */
+static void CheckRoundTrip(HPDF_REAL value, int decimals) {
+  std::string text;
+  PlannerPdfWriter::AppendReal(text, value, decimals);
+
+  /* The whole text is one number */
+  char* end = NULL;
+  double parsed = std::strtod(text.c_str(), &end);
+  PLANNER_CHECK(false == text.empty());
+  PLANNER_CHECK(end == text.c_str() + text.size());
+
+  /* It is the value rounded to decimals, as the libharu writer rounds it
+   * below the 5 decimals libharu writes itself */
+  double scale = std::pow(10.0, decimals);
+  PLANNER_CHECK(std::llround(parsed * scale) ==
+                std::llround((double)value * scale));
+  if (decimals < PlannerDisplayList::Max_decimals) {
+    PLANNER_CHECK((HPDF_REAL)parsed ==
+                  PlannerDisplayList::Quantize(value, decimals));
+  }
+
+  /* Without trailing zeros, a leading zero, a negative zero or extra digits */
+  size_t point = text.find('.');
+  if (std::string::npos != point) {
+    PLANNER_CHECK(point + 1 < text.size());
+    PLANNER_CHECK('0' != text.back());
+    PLANNER_CHECK((int)(text.size() - point - 1) <= decimals);
+    PLANNER_CHECK(0 != text.rfind("0.", 0) && 0 != text.rfind("-0.", 0));
+  }
+  PLANNER_CHECK("-0" != text);
+
+  /* Writing the number read back gives the same text */
+  std::string rewritten;
+  PlannerPdfWriter::AppendReal(rewritten, (HPDF_REAL)parsed, decimals);
+  PLANNER_CHECK(rewritten == text);
+}
+
+/*!
+ * Write the same pages with and without a sink, with enough text to fill
+ * the sink's buffer several times, and check that the sink received the
+ * document Finish returns without one
+ */
+static void CheckSink(HPDF_UINT compression_mode) {
+  const std::uint32_t num_pages = 64;
+  PlannerPdfWriter buffered(compression_mode, 8, num_pages);
+  PlannerPdfWriter streamed(compression_mode, 8, num_pages);
+  std::string sunk;
+  size_t num_chunks = 0;
+  streamed.SetSink([&](const HPDF_BYTE* data, HPDF_UINT32 size) {
+    sunk.append((const char*)data, size);
+    num_chunks++;
+    return true;
+  });
+
+  PlannerDisplayList display_list;
+  for (int line = 0; line < 1000; line++) {
+    display_list.AddText(10, line * 1.5f, 8, "Line " + std::to_string(line));
+  }
+  auto get_target_page = [](PlannerBase*) { return (std::uint32_t)0; };
+  for (std::uint32_t page = 0; page < num_pages; page++) {
+    buffered.AddPage(1404, 1872);
+    streamed.AddPage(1404, 1872);
+  }
+  for (std::uint32_t page = 0; page < num_pages; page++) {
+    buffered.WritePage(page, display_list, get_target_page);
+    streamed.WritePage(page, display_list, get_target_page);
+  }
+  const std::string& pdf = buffered.Finish();
+  PLANNER_CHECK(true == streamed.Finish().empty());
+  PLANNER_CHECK(true == streamed.IsSunk());
+  PLANNER_CHECK(pdf.size() == streamed.GetSize());
+  PLANNER_CHECK(pdf == sunk);
+  if (HPDF_COMP_NONE == compression_mode) {
+    PLANNER_CHECK(num_chunks > 1);
+  }
+}
+
+int main() {
+  std::vector<HPDF_REAL> values = {0,     0.5,    -0.5,    1,      -1,
+                                   0.05,  0.0049, 1404,    1872,   -1404,
+                                   0.1,   0.25,   99.995f, 123.45f, 0.00001f,
+                                   -0.4f, 10,     100,     1000.5f, 3.14159f};
+  /* Coordinates in the range of the pages, in steps which are not powers of
+   * ten, as produced by dividing sections into columns */
+  for (HPDF_REAL value = -100; value < 2000; value += 7.0f / 3) {
+    values.push_back(value);
+  }
+
+  for (int decimals = 0; decimals <= PlannerDisplayList::Max_decimals;
+       decimals++) {
+    for (HPDF_REAL value : values) {
+      CheckRoundTrip(value, decimals);
+    }
+  }
+
+  /* The shortest forms written for each precision */
+  std::string text;
+  PlannerPdfWriter::AppendReal(text, 0.5f, 1);
+  PLANNER_CHECK(".5" == text);
+  text.clear();
+  PlannerPdfWriter::AppendReal(text, -0.25f, 2);
+  PLANNER_CHECK("-.25" == text);
+  text.clear();
+  PlannerPdfWriter::AppendReal(text, 12.5f, 0);
+  PLANNER_CHECK("13" == text);
+  text.clear();
+  PlannerPdfWriter::AppendReal(text, 1404.0f, 5);
+  PLANNER_CHECK("1404" == text);
+
+  CheckSink(HPDF_COMP_NONE);
+  CheckSink(HPDF_COMP_ALL);
+
+  return PlannerTestResult();
+}
@@ -0,0 +1,58 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2015, 2016, 2017 Howard Hinnant
+// Copyright (c) 2016 Adrian Colomitchi
+// Copyright (c) 2017 Florian Dang
+// Copyright (c) 2017 Paul Thompson
+// Copyright (c) 2018, 2019 Tomasz Kamiński
+// Copyright (c) 2019 Jiangang Zhuang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+// Our apologies.  When the previous paragraph was written, lowercase had not
+// yet been invented (that would involve another several millennia of
+// evolution). We did not mean to shout.
+
+#ifndef PLANNER_TEST_HPP
+#define PLANNER_TEST_HPP
+#include <iostream>
+
+/*! The number of checks which failed in the running test */
+inline int& PlannerTestFailures() {
+  static int failures = 0;
+  return failures;
+}
+
+/*!
+ * Check a condition of a test, a failed check is reported with its location
+ * and makes the test return a failure
+ */
+#define PLANNER_CHECK(condition)                                               \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      std::cout << "[ERR] : " << __FILE__ << ":" << __LINE__                   \
+                << " : Check failed : " #condition << std::endl;               \
+      PlannerTestFailures()++;                                                 \
+    }                                                                          \
+  } while (0)
+
+/*! The exit code of a test */
+inline int PlannerTestResult() { return (0 == PlannerTestFailures()) ? 0 : 1; }
+
+#endif // PLANNER_TEST_HPP